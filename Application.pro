@@ -1,6 +1,13 @@
 QT      += core widgets gui charts
 TARGET   = Application
 TEMPLATE = app
-SOURCES  += main.cpp window.cpp authui.cpp adminui.cpp mainui.cpp LoginUI.cpp CredentialsVerifier.cpp record.cpp authstate.cpp authstate_waiting.cpp authstate_success.cpp authstate_deniedinvalid.cpp authstate_deniedtime.cpp authstate_deniedfull.cpp authstate_exit.cpp qrcode.cpp logger.cpp database.cpp Camera.cpp
-HEADERS  += window.h authui.h adminui.h mainui.h LoginUI.h CredentialsVerifier.h record.h authstate.h authstates_header.h qrcode.h logger.h database.h config.h Camera.h
-CONFIG  += debug
+SOURCES  += main.cpp window.cpp authui.cpp adminui.cpp mainui.cpp LoginUI.cpp CredentialsVerifier.cpp record.cpp authstate.cpp authstate_waiting.cpp authstate_success.cpp authstate_deniedinvalid.cpp authstate_deniedtime.cpp authstate_deniedfull.cpp authstate_exit.cpp authstate_group.cpp qrcode.cpp scanqueue.cpp scanfilter.cpp authworker.cpp decisioncache.cpp logger.cpp database.cpp recordstore.cpp journal.cpp mappedfile.cpp snapshot.cpp namepool.cpp bloomfilter.cpp Camera.cpp NativeCamera.cpp framesource.cpp qrtracker.cpp decodepool.cpp
+HEADERS  += window.h authui.h adminui.h mainui.h LoginUI.h CredentialsVerifier.h record.h authstate.h authstates_header.h qrcode.h framering.h scanqueue.h scanfilter.h authworker.h decisioncache.h logger.h database.h recordstore.h journal.h mappedfile.h snapshot.h namepool.h bloomfilter.h sharedvector.h sharedmap.h config.h Camera.h framesource.h qrtracker.h decodepool.h
+CONFIG  += debug c++17
+
+# With USING_CAMERA defined in config.h, Camera.cpp embeds Python; link it with e.g.
+# CONFIG += link_pkgconfig
+# PKGCONFIG += python3-embed
+# or, if USING_NATIVE_CAMERA is defined too, link OpenCV instead:
+# CONFIG += link_pkgconfig
+# PKGCONFIG += opencv4
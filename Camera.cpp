@@ -1,29 +1,154 @@
 /**
 * This class will run the qr code scanner and create a instance of the QRCode class and put the recieved 
 * data from the qr code scanner into it for other classes to use.
+* The scanner itself is the Python program qrcode.py, run through an embedded Python interpreter.
+* Starting that interpreter and importing OpenCV takes seconds on a Raspberry Pi, so it is only
+* done once, the first time the camera is opened, and the interpreter then stays warm for the life
+* of the program (OpenCV and numpy cannot be loaded again into an interpreter that was finalized).
+* Each authentication session opens the video capture once, and each scan only calls the decoder.
+* With USING_NATIVE_CAMERA, the Python backend is replaced by NativeCamera.cpp; the methods shared
+* by both backends are at the end of this file.
 * @brief Runs the QR code scanner and stores the received data in a QRCode object.
 * @author Liam Garrett 
 * @date 2021-11-09
 */
 
-#include <iostream>
-#include <string>
-#include <Python.h>
-#include <qrcode.h>
+#include "config.h"
 
-using namespace std;
+#ifdef USING_CAMERA
 
-bool isRunning;
-const char* data;
-QRCode qr;
+#ifndef USING_NATIVE_CAMERA
+#include <Python.h> // must come before any standard header
+#endif
+#include "Camera.h"
+
+#ifndef USING_NATIVE_CAMERA
+
+// Set once the interpreter is running and its lock has been released, so that other threads may use it
+static std::atomic<bool> pythonReady(false);
+
+/**
+ * Constructor
+ * The interpreter is not started until the camera is first opened.
+ * @brief Creates a camera that isn't scanning.
+*/
+Camera::Camera(){
+	running = false;
+	stopping = false;
+	firstScan = true;
+	module = nullptr;
+	scanFunc = nullptr;
+}
+
+/**
+ * Starts the Python interpreter and imports the qrcode module if this hasn't been
+ * done yet, then opens the video capture. This is called on sessionThread at the start
+ * of each authentication session. Cold and warm start times are written to standard output.
+ * @brief Gets the camera ready to scan QR codes.
+ * @return true if the scanner is ready, false if Python or the qrcode module failed to load.
+*/
+bool Camera::open(){
+	sessionStart = std::chrono::steady_clock::now();
+	firstScan = true;
+
+	if(!initializePython())
+		return false;
+
+	PyGILState_STATE gil = PyGILState_Ensure(); // the camera thread differs from one session to the next
+	bool ready = importModule() && callModule("start_capture", CAMERA_SOURCE);
+	PyGILState_Release(gil);
+
+	if(ready)
+		std::cout << "Camera: ready in " << millisecondsSince(sessionStart) << " ms" << std::endl;
+	return ready;
+}
+
+/**
+ * Releases the video capture at the end of an authentication session. The interpreter
+ * and the qrcode module are kept, so the next session starts warm.
+ * @brief Stops using the camera until it is opened again.
+*/
+void Camera::close(){
+	if(module == nullptr)
+		return;
+	PyGILState_STATE gil = PyGILState_Ensure();
+	callModule("stop_capture");
+	PyGILState_Release(gil);
+}
 
 /**
- * This function will run the python code for scanning and processing QR codes.
+ * This function will run the python code for scanning and processing QR codes. It blocks
+ * until a frame with a code in it is read, the user quits the scanner window, or interrupt()
+ * is called. qrcode.func returns every code in that frame as a list.
  * @brief Scans and processes QR codes.
+ * @return true if codes were read (see codes), false otherwise.
 */
-void start(){
+bool Camera::scan(){
+	if(scanFunc == nullptr)
+		return false;
+
+	std::chrono::steady_clock::time_point scanStart = std::chrono::steady_clock::now();
+	PyGILState_STATE gil = PyGILState_Ensure();
+	PyObject *pValue = PyObject_CallObject(scanFunc, NULL); // execute the function
+
+	data.clear();
+	if(pValue == nullptr){
+		PyErr_Print();
+	}else{
+		if(PyList_Check(pValue)){ // every code in the frame; None means the scan was stopped without a code being read
+			for(Py_ssize_t i = 0; i < PyList_Size(pValue); i++)
+				appendPayload(PyList_GetItem(pValue, i));
+		}else{
+			appendPayload(pValue);
+		}
+		Py_DECREF(pValue);
+	}
+	PyGILState_Release(gil);
 
-	PyObject *pModule, *pFunc, *pValue; // 3 PyObjects required for running python file
+	bool found = !data.empty();
+	if(found)
+		accept(scanStart);
+	return found;
+}
+
+/**
+ * Called by scan() with the interpreter lock held. Anything but a non-empty string is ignored.
+ * @brief Adds a payload returned by qrcode.func to those read by the scan.
+ * @param value    The Python object holding the payload.
+*/
+void Camera::appendPayload(PyObject *value){
+	Py_ssize_t size;
+	const char *text = PyUnicode_Check(value) ? PyUnicode_AsUTF8AndSize(value, &size) : nullptr;
+	if(text != nullptr && size > 0)
+		data.emplace_back(text, size);
+}
+
+/**
+ * Called by stop() on the GUI thread. qrcode.stop_scan() makes a scan in progress
+ * return as soon as its current frame is decoded. Until the qrcode module has been
+ * imported there is no scan to stop, and the session ends once open() returns.
+ * @brief Makes the scan running on sessionThread return.
+*/
+void Camera::interrupt(){
+	if(!pythonReady)
+		return;
+	PyGILState_STATE gil = PyGILState_Ensure();
+	if(module != nullptr) // written by sessionThread with the interpreter lock held
+		callModule("stop_scan");
+	PyGILState_Release(gil);
+}
+
+/**
+ * Starts the interpreter the first time it is called, and leaves the global
+ * interpreter lock released, so that any thread can take it to use the camera.
+ * @brief Starts the embedded Python interpreter once.
+ * @return true once the interpreter is running.
+*/
+bool Camera::initializePython(){
+	if(Py_IsInitialized())
+		return true;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 	Py_Initialize(); // start the python interpreter
 	PyRun_SimpleString("import sys");// import the required packages for the python code
 	PyRun_SimpleString("import cv2");
@@ -31,33 +156,123 @@ void start(){
 	PyRun_SimpleString("sys.path.append('./home/pi/Desktop/tester')"); // set the working directory on the raspberry pi 
 	PyRun_SimpleString("sys.path.append('/home/pi/Desktop/tester')");
 	PyRun_SimpleString("sys.path.insert(0,'/home/pi/Desktop/tester')");
-	
-	pModule = PyImport_ImportModule("qrcode"); // set the name of the python program to be opened
-	
-	if (pModule) { // if the module imported the proper program
-		pFunc = PyObject_GetAttrString(pModule,"func");} // get the function for running the qrcode scanner
-	
-	if (pFunc) { // if the fuction was imported properly
-		pValue = PyObject_CallObject(pFunc, NULL);// execute the function
-		isRunning = true; // process is running
-	} 
-		
-    PyObject* repr = PyObject_Repr(pValue); // convert the recieved value into a string 
-    PyObject* str = PyUnicode_AsEncodedString(repr, "utf-8", "~E~");
-	data = PyBytes_AS_STRING(str); // set the string for the new QR code
-    printf("QR code info %s\n", data);
-	qr.setData(data);
-	qr.setCreationTime();
-	Py_Finalize(); // close the python interpreter
-	isRunning = false;
-}
-
-/**
- * Function for stopping the qrcode scanning.
- * @brief Stops the QR code scanning.
+	PyEval_SaveThread(); // release the lock taken by Py_Initialize()
+	pythonReady = true;
+	std::cout << "Camera: Python interpreter started in " << millisecondsSince(start) << " ms (cold)" << std::endl;
+	return true;
+}
+
+/**
+ * Called with the interpreter lock held. Only the first call does any work.
+ * @brief Imports the qrcode module and looks up its scanning function.
+ * @return true if the module and its function are available.
 */
-void stop() {
+bool Camera::importModule(){
+	if(scanFunc != nullptr)
+		return true;
 
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if(module == nullptr)
+		module = PyImport_ImportModule("qrcode"); // set the name of the python program to be opened
+	if(module != nullptr) // if the module imported the proper program
+		scanFunc = PyObject_GetAttrString(module, "func"); // get the function for running the qrcode scanner
+	if(scanFunc == nullptr){
+		PyErr_Print();
+		return false;
+	}
+	std::cout << "Camera: qrcode module imported in " << millisecondsSince(start) << " ms (cold)" << std::endl;
+	return true;
+}
+
+/**
+ * Called with the interpreter lock held.
+ * @brief Calls a function of the qrcode module.
+ * @param name    The name of the function.
+ * @param arg     A string to pass to the function, or nullptr to pass nothing.
+ * @return true if the function ran without raising an exception.
+*/
+bool Camera::callModule(const char *name, const char *arg){
+	PyObject *result = arg != nullptr ? PyObject_CallMethod(module, name, "s", arg) : PyObject_CallMethod(module, name, NULL);
+	if(result == nullptr){
+		PyErr_Print();
+		return false;
+	}
+	Py_DECREF(result);
+	return true;
+}
+
+/**
+ * Decodes every frame of a recording as fast as possible with qrcode.replay(), to
+ * measure how fast the decoder is on this machine; the report is written to standard
+ * output by the module.
+ * @brief Measures decoding throughput on recorded footage.
+ * @param spec    A video file or a directory of images (or a camera number).
+ * @return true if at least one frame was decoded.
+*/
+bool Camera::replay(const std::string &spec){
+	Camera camera;
+	if(!initializePython())
+		return false;
+	PyGILState_STATE gil = PyGILState_Ensure();
+	bool replayed = false;
+	if(camera.importModule()){
+		PyObject *frames = PyObject_CallMethod(camera.module, "replay", "s", spec.c_str());
+		if(frames == nullptr)
+			PyErr_Print();
+		else{
+			replayed = PyObject_IsTrue(frames) == 1;
+			Py_DECREF(frames);
+		}
+	}
+	PyGILState_Release(gil);
+	return replayed;
+}
+
+/**
+ * Destructor
+ * The interpreter is deliberately left running, since other threads may still use
+ * it while the program exits.
+ * @brief Stops the camera.
+*/
+Camera::~Camera(){
+	stop();
+}
+
+#endif // USING_NATIVE_CAMERA
+
+/**
+ * Starts a scanning session on a thread of its own, and returns at once. The session
+ * opens the camera (loading whatever the backend needs the first time), then reads
+ * codes until stop() is called, the camera stops delivering frames, or the user quits
+ * the scanner window, handing the codes read from each frame to the given function.
+ * @brief Starts scanning QR codes in the background.
+ * @param onCodes    Called on the camera's thread with the codes of every scan, in the order they were read.
+ * @return true if a session was started, false if one is already running.
+*/
+bool Camera::start(std::function<void(const std::vector<QRCode>&)> onCodes) {
+	if(running)
+		return false;
+	if(sessionThread.joinable())
+		sessionThread.join(); // a session that ended on its own
+	this->onCodes = onCodes;
+	stopping = false;
+	running = true; // process is running
+	sessionThread = std::thread(&Camera::run, this);
+	return true;
+}
+
+/**
+ * Function for stopping the qrcode scanning. The scan in progress is interrupted,
+ * so this returns within about one frame, once the camera has been closed. Only
+ * stopping during the very first session's start-up, while Python or OpenCV is
+ * still loading, has to wait for it to finish.
+ * @brief Stops the QR code scanning.
+*/
+void Camera::stop() {
+	stopping = true;
+	interrupt();
+	if(sessionThread.joinable())
+		sessionThread.join();
 }
 
 /**
@@ -65,21 +280,60 @@ void stop() {
  * @brief Returns if the scanner is running or not.
  * @return A bool which is true if the scanner is running, else false
 */
-bool isRunning() { // return if the program is running or not
-	return isRunning;
+bool Camera::isRunning() { // return if the program is running or not
+	return running;
+}
+
+/**
+ * @brief The body of sessionThread: opens the camera, scans until told to stop, then closes it.
+*/
+void Camera::run() {
+	if(open()){
+		while(!stopping && scan())
+			onCodes(codes);
+		close();
+	}
+	running = false;
 }
 
 /**
  * Function for returning the QRCode instance if it has been created.
  * @brief Returns the QRCode instance if created.
- * @return QRCode qr or returns NULL
+ * @return The QR code read last; its data is "NULL" if none was read yet.
 */
-QRCode toQRCode() {// return if the value of the QR code
+QRCode Camera::toQRCode() {// return if the value of the QR code
+	return qr;
+}
 
-	if ( strcmp(qr.getData(),"NULL") == 0 ) {
-		return NULL;
-	}
-	else {
-		return qr;
-	}
+/**
+ * Called by scan() once codes have been read. With SCAN_TIMING defined in config.h, the time
+ * the scan took is written to standard output; the first scan of a session is cold, since it
+ * includes warming up the capture.
+ * @brief Turns the payloads just read into codes; the last is returned by toQRCode().
+ * @param scanStart    When the scan began.
+*/
+void Camera::accept(std::chrono::steady_clock::time_point scanStart){
+#ifdef SCAN_TIMING
+	std::cout << "Camera: " << data.size() << (data.size() == 1 ? " QR code" : " QR codes") << " read in "
+	          << millisecondsSince(scanStart) << " ms (" << (firstScan ? "cold" : "warm") << ", "
+	          << millisecondsSince(sessionStart) << " ms into the session)" << std::endl;
+#else
+	(void)scanStart;
+#endif
+	firstScan = false;
+	codes.clear();
+	for(const std::string &payload : data)
+		codes.push_back(QRCode(payload));
+	qr = codes.back();
 }
+
+/**
+ * @brief Returns the time elapsed since the given moment.
+ * @param start    The moment to measure from.
+ * @return The elapsed time in milliseconds.
+*/
+double Camera::millisecondsSince(std::chrono::steady_clock::time_point start){
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
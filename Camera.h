@@ -1,6 +1,9 @@
 /**
  * This represents the camera that the system uses to take a picture of the QR code.
  * All methods and variables that the camera uses are defined here.
+ * Two backends implement it, chosen in config.h: by default the scanner is the Python
+ * program qrcode.py (Camera.cpp), and with USING_NATIVE_CAMERA it is OpenCV's C++ API
+ * (NativeCamera.cpp).
  * @brief Header file of the camera class.
  * @author Liam Garrett
  * */
@@ -11,21 +14,74 @@
 
 #include <iostream>
 #include <string>
-#include <Python.h>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
 #include "qrcode.h"
+#include "config.h"
+#include "framering.h"
 
+#ifdef USING_NATIVE_CAMERA
+namespace cv { class Mat; } // Defined by OpenCV, which is only included by NativeCamera.cpp
+class FrameSource; // See framesource.h
+class DecodePool; // See decodepool.h
+#else
+typedef struct _object PyObject; // Defined by Python.h, which is only included by Camera.cpp
+#endif
 
 class Camera{
 	private:
-		bool running;
-		const char* data;
+		std::atomic<bool> running; // A session is running on sessionThread
+		std::atomic<bool> stopping; // stop() has been called, and the session should end
+		std::thread sessionThread; // Opens the camera, then scans codes until the session ends
+		std::function<void(const std::vector<QRCode>&)> onCodes; // Called on sessionThread with the codes of every scan
+		bool firstScan; // No code has been read yet this session
+		std::vector<std::string> data; // The payloads read by the last scan
+		std::vector<QRCode> codes; // The codes read by the last scan, one per payload
 		QRCode qr;
+		std::chrono::steady_clock::time_point sessionStart;
+
+		#ifdef USING_NATIVE_CAMERA
+		std::unique_ptr<FrameSource> source; // Where frames come from (CAMERA_SOURCE); open while a session is running
+		std::unique_ptr<DecodePool> decoders; // Decode frames on every core; created once and kept for the life of the camera
+		std::unique_ptr<FrameRing<cv::Mat>> frames; // The latest frames read by captureThread
+		std::thread captureThread; // Reads the camera while a session is running
+		std::atomic<bool> capturing; // captureThread is running
+
+		void captureLoop();
+		bool nextFrame(cv::Mat &frame);
+		static bool replayPass(const std::string &spec, bool multi, std::size_t workers,
+		                       double &millisecondsPerFrame, double &decodesPerSecond);
+		#else
+		PyObject *module; // The qrcode module, imported once and kept for the life of the program
+		PyObject *scanFunc; // qrcode.func, which blocks until it reads a code
+
+		static bool initializePython();
+		bool importModule();
+		bool callModule(const char *name, const char *arg = nullptr);
+		void appendPayload(PyObject *value);
+		#endif
+
+		bool open();
+		void close();
+		bool scan();
+		void interrupt();
+		void run();
+		void accept(std::chrono::steady_clock::time_point scanStart);
+		static double millisecondsSince(std::chrono::steady_clock::time_point start);
 	public:
-		void start();
+		Camera();
+		~Camera();
+		bool start(std::function<void(const std::vector<QRCode>&)> onCodes);
 		void stop();
 		bool isRunning();
 		QRCode toQRCode();
 
+		static bool replay(const std::string &spec);
+
 };
 
 #endif
@@ -0,0 +1,251 @@
+/**
+* The native backend of the Camera class, used instead of Camera.cpp's Python backend when
+* USING_NATIVE_CAMERA is defined in config.h. Frames are read from a FrameSource (a camera,
+* a video file or a directory of images, see CAMERA_SOURCE) and decoded with
+* cv::QRCodeDetector straight from C++, so no interpreter is started, nothing
+* is marshalled through Python objects, and the payload is stored exactly as decoded.
+* A QRTracker searches each frame at a reduced size and decodes only the region of a code.
+* The decode workers are created once, and each authentication session opens the frame source once.
+* A capture thread then reads frames as fast as the camera delivers them into a FrameRing,
+* while a DecodePool decodes the freshest frames on every core, each worker skipping any frames
+* that arrived during its last decode, and hands the codes back to scan() in frame order.
+* A slow decode therefore never stalls the capture or lets stale frames pile up in the
+* driver's buffer, and the time from a pass coming into view to its code being read stays
+* within about two decodes.
+* The methods shared by both backends are in Camera.cpp.
+* @brief Runs the QR code scanner with OpenCV's C++ API.
+* @author Liam Garrett
+*/
+
+#include "config.h"
+
+#if defined(USING_CAMERA) && defined(USING_NATIVE_CAMERA)
+
+#include <opencv2/core.hpp>
+#include "Camera.h"
+#include "framesource.h"
+#include "decodepool.h"
+
+// How long a decode worker waits for a frame before checking that the session is still running
+static const std::chrono::milliseconds FRAME_WAIT(100);
+
+// The most decode workers replay() measures
+static const std::size_t REPLAY_WORKERS = 4;
+
+/**
+ * Constructor
+ * The camera is not touched until it is opened.
+ * @brief Creates a camera that isn't scanning.
+*/
+Camera::Camera(){
+	running = false;
+	stopping = false;
+	firstScan = true;
+	capturing = false;
+	frames.reset(new FrameRing<cv::Mat>(FRAME_RING_SIZE));
+}
+
+/**
+ * Opens the frame source for an authentication session, creating the decode workers
+ * the first time, and starts the capture thread and the decode workers. This is called on sessionThread at
+ * the start of each session. The time taken is written to standard output.
+ * @brief Gets the camera ready to scan QR codes.
+ * @return true if the scanner is ready, false if the frame source could not be opened.
+*/
+bool Camera::open(){
+	sessionStart = std::chrono::steady_clock::now();
+	firstScan = true;
+
+	if(!decoders)
+		decoders.reset(new DecodePool(DECODE_WORKERS, QR_MULTI_CODE));
+	source = FrameSource::create(CAMERA_SOURCE, true);
+	if(!source->open()){
+		std::cout << "Camera: could not open " << source->describe() << std::endl;
+		source.reset();
+		return false;
+	}
+	frames->reopen();
+	capturing = true;
+	captureThread = std::thread(&Camera::captureLoop, this);
+	decoders->start([this](cv::Mat &frame){ return nextFrame(frame); });
+
+	std::cout << "Camera: ready in " << millisecondsSince(sessionStart) << " ms (native, "
+	          << decoders->size() << " decode workers)" << std::endl;
+	return true;
+}
+
+/**
+ * Stops the capture thread and the decode workers, and closes the frame source at the end
+ * of an authentication session. How many frames were read, decoded and skipped is written
+ * to standard output.
+ * @brief Stops using the camera until it is opened again.
+*/
+void Camera::close(){
+	if(!source)
+		return;
+	capturing = false;
+	if(captureThread.joinable())
+		captureThread.join(); // which closes the frame ring, so the workers run out of frames
+	decoders->stop();
+	source->close();
+	source.reset();
+
+	FrameRingStats stats = frames->stats();
+	DecodePoolStats decoding = decoders->stats();
+	std::cout << "Camera: " << stats.pushed << " frames captured, " << stats.taken << " decoded, "
+	          << stats.skipped << " skipped; " << decoding.tracking.located << " codes located in "
+	          << decoding.tracking.searches << " searches, " << decoding.tracking.tracked << " tracked, "
+	          << decoding.duplicates << " duplicates merged" << std::endl;
+}
+
+/**
+ * Waits for the decode workers to read codes from the freshest frames of the capture
+ * thread. It blocks until a code is read, the source runs out of frames, or interrupt()
+ * is called. With QR_MULTI_CODE, every code in a frame is read; codes read from frames
+ * decoded at the same time are merged, in frame order.
+ * @brief Scans and processes QR codes.
+ * @return true if codes were read (see codes), false otherwise.
+*/
+bool Camera::scan(){
+	if(!source)
+		return false;
+
+	std::chrono::steady_clock::time_point scanStart = std::chrono::steady_clock::now();
+	bool found = decoders->collect(data) && !stopping;
+
+	if(found)
+		accept(scanStart);
+	return found;
+}
+
+/**
+ * The decode workers' feed, called by one worker at a time. Waiting for a frame is
+ * cut short every FRAME_WAIT to check whether the session is over.
+ * @brief Takes the freshest frame from the capture thread.
+ * @param frame    Receives the frame.
+ * @return true if a frame was taken; false once the capture has stopped or stop() was called.
+*/
+bool Camera::nextFrame(cv::Mat &frame){
+	while(!frames->takeLatest(frame, FRAME_WAIT)){
+		if(!capturing || stopping)
+			return false; // the camera stopped delivering frames, or the session is over
+	}
+	return true;
+}
+
+/**
+ * Called by stop() on the GUI thread. Closing the frame ring wakes the decode workers
+ * waiting for a frame, and the others stop once their frame is decoded; scan() returns
+ * once they all have.
+ * @brief Makes the scan running on sessionThread return.
+*/
+void Camera::interrupt(){
+	frames->close();
+}
+
+/**
+ * Runs on captureThread from open() to close(). Each frame is read into a new buffer,
+ * since the decoder may still be holding the previous one.
+ * @brief Reads frames into the frame ring as fast as the camera delivers them.
+*/
+void Camera::captureLoop(){
+	while(capturing){
+		cv::Mat frame;
+		if(!source->read(frame))
+			break;
+		frames->push(std::move(frame));
+	}
+	capturing = false;
+	frames->close();
+}
+
+/**
+ * Decodes every frame of a recording several times: reading one code per frame with a
+ * single worker, then every code with one to REPLAY_WORKERS workers, to measure how fast
+ * the decoder is on this machine, what reading whole groups costs, and how decoding
+ * scales across cores (see replayPass()). The per-frame cost of reading one code and
+ * every code, and the decodes per second of each number of workers, are compared at the end.
+ * @brief Measures decoding throughput on recorded footage.
+ * @param spec    A video file or a directory of images (or a camera, see FrameSource::create()).
+ * @return true if at least one frame was decoded.
+*/
+bool Camera::replay(const std::string &spec){
+	double single, multi, rate;
+	std::vector<double> rates;
+	if(!replayPass(spec, false, 1, single, rate))
+		return false;
+	for(std::size_t workers = 1; workers <= REPLAY_WORKERS; workers++){
+		double perFrame;
+		if(!replayPass(spec, true, workers, perFrame, rate))
+			return false;
+		if(workers == 1)
+			multi = perFrame;
+		rates.push_back(rate);
+	}
+
+	std::cout << "Reading every code costs " << multi - single << " ms per frame more than reading one ("
+	          << (single > 0 ? 100 * (multi - single) / single : 0) << "%)" << std::endl;
+	std::cout << "Decodes/s with 1 to " << rates.size() << " workers:";
+	for(double workerRate : rates)
+		std::cout << " " << workerRate;
+	std::cout << " (" << (rates.front() > 0 ? rates.back() / rates.front() : 0) << "x with " << rates.size() << ")" << std::endl;
+	return true;
+}
+
+/**
+ * Decodes every frame of a recording with a DecodePool, taking frames as fast as they
+ * can be read rather than at their frame rate. A report is written to standard output:
+ * frames decoded per second of wall-clock time, which is what adding workers should raise
+ * (unless reading the recording is the bottleneck), the average time one decode kept a
+ * worker busy, how many frames held a code, how many codes were read
+ * in all and how many were left once merged, and how many were located by a search or
+ * found in their last region.
+ * @brief Measures decoding throughput on recorded footage with a given number of workers.
+ * @param spec                  The recording (see replay()).
+ * @param multi                 Whether every code in a frame is read, or just one.
+ * @param workers               How many frames are decoded at once.
+ * @param millisecondsPerFrame  Set to the average time one decode took.
+ * @param decodesPerSecond      Set to the frames decoded per second of wall-clock time.
+ * @return true if at least one frame was decoded.
+*/
+bool Camera::replayPass(const std::string &spec, bool multi, std::size_t workers,
+                        double &millisecondsPerFrame, double &decodesPerSecond){
+	std::unique_ptr<FrameSource> source = FrameSource::create(spec, false);
+	if(!source->open()){
+		std::cout << "Replay: could not open " << source->describe() << std::endl;
+		return false;
+	}
+
+	DecodePool pool(workers, multi);
+	std::vector<std::string> data;
+	std::size_t merged = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.start([&source](cv::Mat &frame){ return source->read(frame); });
+	while(pool.collect(data))
+		merged += data.size();
+	pool.stop();
+	double seconds = millisecondsSince(start) / 1000;
+	source->close();
+
+	DecodePoolStats stats = pool.stats();
+	millisecondsPerFrame = stats.frames > 0 ? stats.busyMilliseconds / stats.frames : 0;
+	decodesPerSecond = seconds > 0 ? stats.frames / seconds : 0;
+
+	std::cout << "Replay of " << source->describe() << (multi ? ", every code" : ", one code") << " per frame, "
+	          << workers << (workers == 1 ? " worker: " : " workers: ") << stats.frames << " frames in " << seconds << " s, "
+	          << decodesPerSecond << " decodes/s ("
+	          << millisecondsPerFrame << " ms per decode), " << stats.withCode << " frames with a code, "
+	          << stats.codes << " codes, " << merged << " once merged (" << stats.tracking.located << " located in "
+	          << stats.tracking.searches << " searches, " << stats.tracking.tracked << " tracked)" << std::endl;
+	return stats.frames > 0;
+}
+
+/**
+ * Destructor
+ * @brief Stops the capture thread and releases the camera.
+*/
+Camera::~Camera(){
+	stop();
+}
+
+#endif
@@ -66,6 +66,7 @@ AdminUI::AdminUI(QWidget *parent):QWidget(parent){
     connect(search, &QPushButton::pressed, this, &AdminUI::searchRec);
     connect(smallEditor, &QListWidget::itemClicked, this, &AdminUI::fillEditor);
     connect(edit, &QPushButton::pressed, this, &AdminUI::editRec);
+    connect(importFile, &QPushButton::pressed, this, &AdminUI::importRec);
     connect(clearWindow, &QPushButton::pressed, this, &AdminUI::cleanWindow);
     connect(execute, &QPushButton::pressed, this, &AdminUI::computeAnalysis);
 
@@ -126,6 +127,9 @@ void AdminUI::createCommandWindow()
     
     edit = new QPushButton(tr("Edit"));
     layout->addWidget(edit);
+
+    importFile = new QPushButton(tr("Import"));
+    layout->addWidget(importFile);
     
     clearRec = new QPushButton(tr("Clear"));
     layout->addWidget(clearRec);
@@ -664,6 +668,42 @@ void AdminUI::addRec(){
     isrecordSelected = false;
 }
 
+/**
+ * Asks the user for a roster file of "id,first,last,date" lines and adds or updates every
+ * record in it as a single batch, showing the progress of the import as it runs.
+ * @brief Imports the records of a roster file into the vax database.
+*/
+void AdminUI::importRec(){
+
+    QString path = QFileDialog::getOpenFileName(this, tr("Import Records"), QString(), tr("Records (*.txt *.csv);;All Files (*)"));
+    if(path.isEmpty()){
+        return;
+    }
+
+    std::ifstream fin(path.toStdString());
+    if(!fin.is_open()){
+        result_label->setText(QString::fromStdString("Cannot Open File"));
+        return;
+    }
+
+    QProgressDialog progress(tr("Importing records..."), QString(), 0, 1000, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);   // only shown for imports that take a while
+
+    BatchResult result = Database::instance().upsertText(fin, [&progress](std::size_t done, std::size_t total){
+        progress.setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+        QCoreApplication::processEvents();
+    });
+    progress.setValue(1000);
+
+    result_label->setText(QString("%1 Added, %2 Updated, %3 Skipped, %4 Invalid")
+        .arg(result.added).arg(result.updated).arg(result.skipped).arg(result.invalid));
+
+    smallEditor->clear();
+    clearLineEdit();
+    isrecordSelected = false;
+}
+
 /**
  * Takes the user input entered in the record text fields and removes 
  * the defined record from the vax database if valid.
@@ -720,121 +760,27 @@ void AdminUI::deleteSpecRec(){
 /**
  * Based on the user's input in the text fields, this method returns a query
  * of all the vax records which match the entered fields and displays it to the results box.
+ * Fields left empty match every record, so any combination of fields can be searched.
  * @brief Displays a query of records matching the fields defined by the user.
 */
  void AdminUI::searchRec(){
 
-    bool cond = false;
-    bool empty = true;
     smallEditor->clear();
-    std::vector<Record> results;
-    Record result;
-
-    //NO input fields entered
-    if(id_line->text().isEmpty() && fName_line->text().isEmpty() && lName_line->text().isEmpty() && twoDose_line->text().isEmpty()){    
-        
-        results = Database::instance().getAll();
-        if(results.size() != 0){
-            empty = false;
-        }    
-
-    // ID field is entered
-    }else if(!id_line->text().isEmpty()){
-        cond = true;
-        std::string id_num = (id_line->text()).toStdString();
-        // Check if exists
-        if(Database::instance().findId(id_num)){
-            result = Database::instance().searchById(id_num);
-            empty = false;
-        }
-
-    // First name is entered
-    }else if(!fName_line->text().isEmpty() && lName_line->text().isEmpty() && twoDose_line->text().isEmpty()){
-        
-        std::string name = (fName_line->text()).toStdString();
-        // Check if exists
-        if(Database::instance().findFirst(name)){
-            results = Database::instance().searchByFirst(name);
-            empty = false;
-        }
-       
-    // Last name is entered
-    }else if(fName_line->text().isEmpty() && !lName_line->text().isEmpty() && twoDose_line->text().isEmpty()){
-        
-        std::string name = (lName_line->text()).toStdString();
-        // Check if exists
-        if(Database::instance().findlast(name)){
-            results = Database::instance().searchByLast(name);
-            empty = false;
-        }
-
-    // vax dose date
-    }else if(fName_line->text().isEmpty() && lName_line->text().isEmpty() && !twoDose_line->text().isEmpty()){
-        
-        std::string date = (twoDose_line->text()).toStdString();
-        // Check if exists
-        if(Database::instance().findDate(date)){
-            results = Database::instance().searchByDate(date);
-            empty = false;
-        }
 
-    // first and last name entered
-    }else if(!fName_line->text().isEmpty() && !lName_line->text().isEmpty() && twoDose_line->text().isEmpty()){
-        
-        std::string first = (fName_line->text()).toStdString();
-        std::string last = (lName_line->text().toStdString());
-        // Check if exists
-        if(Database::instance().findFirstLast(first, last)){
-            results = Database::instance().searchByFirstLast(first,last);
-            empty = false;
-        }
-
-    // last name and dose date entered
-    }else if(fName_line->text().isEmpty() && !lName_line->text().isEmpty() && !twoDose_line->text().isEmpty()){
-        
-        std::string date = (twoDose_line->text()).toStdString();
-        std::string last = (lName_line->text().toStdString());
-        // Check if exists
-        if(Database::instance().findLastDate(last, date)){
-            results = Database::instance().searchByLastDate(last,date);
-            empty = false;
-        }
+    std::string id = (id_line->text()).toStdString();
+    std::string first = (fName_line->text()).toStdString();
+    std::string last = (lName_line->text()).toStdString();
+    std::string date = (twoDose_line->text()).toStdString();
 
-    // first name and dose date entered
-    }else if(!fName_line->text().isEmpty() && lName_line->text().isEmpty() && !twoDose_line->text().isEmpty()){
-        
-        std::string date = (twoDose_line->text()).toStdString();
-        std::string first = (fName_line->text().toStdString());
-        // Check if exists
-        if(Database::instance().findFirstDate(first, date)){
-            results = Database::instance().searchByFirstDate(first,date);
-            empty = false;
-        }
-    
-    }else if(!fName_line->text().isEmpty() && !lName_line->text().isEmpty() && !twoDose_line->text().isEmpty()){
-        
-        std::string date = (twoDose_line->text()).toStdString();
-        std::string first = (fName_line->text().toStdString());
-        std::string last = (lName_line->text().toStdString());
-        // Check if exists
-        if(Database::instance().findFirstLastDate(first,last,date)){
-            results = Database::instance().searchByFirstLastDate(first,last,date);
-            empty = false;
-        }
-    }
+    std::vector<Record> results = Database::instance().query(id, first, last, date);
 
     clearLineEdit();
     isrecordSelected = false;
 
-    if(cond && !empty){
-        std::string temp = cleanFormat(result.getId()) + "," + cleanFormat(result.getfName()) + "," + cleanFormat(result.getlName()) + "," + cleanFormat(result.getDate());
-        smallEditor->insertItem(0,QString::fromStdString(temp));
-        result_label->setText(QString::fromStdString("Search Successful"));
-    
-    }else if(!cond && !empty){
+    if(!results.empty()){
         std::string temp;
         for(std::vector<int>::size_type i = 0; i < results.size(); i++){
-            temp = cleanFormat(results.at(i).getId()) + "," + cleanFormat(results.at(i).getfName()) + "," + cleanFormat(results.at(i).getlName()) + "," + cleanFormat(results.at(i).getDate());
+            temp = cleanFormat(std::string(results.at(i).getId())) + "," + cleanFormat(results.at(i).getfName()) + "," + cleanFormat(results.at(i).getlName()) + "," + cleanFormat(std::string(results.at(i).getDate()));
             smallEditor->insertItem(i,QString::fromStdString(temp));
         }
         result_label->setText(QString::fromStdString("Search Successful"));
@@ -30,6 +30,8 @@
 #include <QListWidgetItem>
 #include <QString>
 #include <QDateTimeEdit>
+#include <QFileDialog>
+#include <QProgressDialog>
 #include <QChartView>
 #include <QtCharts>
 #include <QList>
@@ -66,6 +68,7 @@ class AdminUI : public QWidget{
         void searchRec();
         void fillEditor(QListWidgetItem *);
         void editRec();
+        void importRec();
         void cleanWindow();
         void toMain();
         void toAuth();
@@ -124,6 +127,7 @@ class AdminUI : public QWidget{
         QPushButton *del;
         QPushButton *search;
         QPushButton *edit;
+        QPushButton *importFile;
         QPushButton *clearRec;
         QPushButton *clearWindow;
         QPushButton *clear;
@@ -21,12 +21,17 @@
 AuthState::AuthState(){
 	ui = AuthUI::getInstance();
 	duration = 7;
+	minDwell = 0;
+	verdict = "";
+	denial = false;
 }
 
 /**
  * This method should not be overridden. It calls all of the other behaviours
- * in this class in the appropriate sequence to do UI update, a minimum display time,
- * and logging. It takes a user arg, which is used by updateUI().
+ * in this class in the appropriate sequence to do UI update and logging. It takes
+ * a user arg, which is used by updateUI(). It returns straight away: keeping the
+ * state on screen for its minimum display time is up to AuthUI (see getDuration()),
+ * so the event loop keeps running while the state is shown.
  * @brief Universal implementation for when the state is activated.
  * @param user    The user whose information should be displayed on screen.
 */
@@ -34,13 +39,17 @@ void AuthState::activate(Record *user){
 	resetUI(); // Blank all of the labels so ones not set in updateUI() aren't visible
 	updateUI(user);
 	logEvent(user);
+}
 
-	// Before blocking, make sure all of the pending Qt events for this
-	// thread have been processed. This ensures that the UI changes made
-	// in updateUI() are painted first.
-	QApplication::instance()->processEvents();
-
-	sleepDuration();
+/**
+ * This, combined with the setting of variable duration in the constructor,
+ * tells AuthUI how long this state's UI must remain visible before AuthUI
+ * changes states again. A duration of 0 means the state can be replaced at once.
+ * @brief Get the class's minimum display time.
+ * @return The minimum display time, in seconds.
+ */
+int AuthState::getDuration(){
+	return duration;
 }
 
 /**
@@ -60,18 +69,37 @@ void AuthState::resetUI(){
 	ui->setStatusIcon("");
 }
 
-/*
- * This, combined with the setting of variable duration in the constructor,
- * will block the calling thread when an AuthState is activated, guranteeing
- * that it's UI state will remain visible for some minimum number of seconds
- * before AuthUI changes states again.
- * @brief Block for the class's minimum display time.
+/**
+ * In express-lane mode (see config.h) a new scan replaces the state on screen
+ * as soon as it has been visible for this long, rather than for its whole duration.
+ * @brief Get the class's minimum display time in express-lane mode.
+ * @return The minimum display time, in seconds.
+ */
+int AuthState::getMinDwell(){
+	return minDwell;
+}
+
+/**
+ * When several codes are read from one frame, their states are shown together
+ * in an AuthStateGroup, which lists each user with this short outcome.
+ * @brief Get the class's outcome as shown within a group.
+ * @return The outcome, e.g. "Accepted".
+ */
+std::string AuthState::getVerdict(){
+	return verdict;
+}
+
+/**
+ * @brief Get whether the class turns the user away.
+ * @return True if the user may not proceed; false otherwise.
  */
-void AuthState::sleepDuration(){
-	sleep(duration);
+bool AuthState::isDenial(){
+	return denial;
 }
 
 /**
+ * Virtual, so that deleting a state through an AuthState pointer also
+ * destroys what a derived class holds (see AuthStateGroup).
  * @brief Empty destructor.
  */
 AuthState::~AuthState(){
@@ -12,28 +12,34 @@
 #ifndef AUTH_STATE_H
 #define AUTH_STATE_H
 
-#include <unistd.h>
-
-#include <QApplication>
-
 #include "record.h"
 #include "authui.h"
 #include "logger.h"
+#include "config.h"
+
+#include <string>
 
 class AuthUI; // Forward declaration
 
 class AuthState {
 	public:
 		AuthState();
-		void activate(Record *user=nullptr); // Calls updateUI(), logEvent(), wait()
-		~AuthState();
+		void activate(Record *user=nullptr); // Calls updateUI(), logEvent()
+		int getDuration(); // Minimum time this state stays on screen, in seconds
+		int getMinDwell(); // Time before a new scan may replace this state in express-lane mode, in seconds
+		std::string getVerdict(); // Short outcome shown for this state within a group
+		bool isDenial(); // Whether this state turns the user away
+		virtual ~AuthState();
 
 	protected:
 		int duration; // How long, in seconds, to display this screen before resetting
+		int minDwell; // How long, in seconds, this screen stays up even in express-lane mode
+		std::string verdict; // Shown for the user in an AuthStateGroup
+		bool denial; // The user may not proceed
 		AuthUI *ui; // Pointer to UI, which has public mutators to change appearance
 
 	private:
-		void sleepDuration(); // Ensure the state is displayed for minimum duration
+		friend class AuthStateGroup; // Logs the events of its members
 		void resetUI();
 		virtual void logEvent(Record *user=nullptr) = 0; // Logging behaviour for event assoc. w/ this state
 		virtual void updateUI(Record *user=nullptr) = 0; // Behaviour to alter AuthUI appearance for this state
@@ -9,10 +9,13 @@
 
 AuthStateDeniedFull::AuthStateDeniedFull(){ 
 	duration = 10;
+	minDwell = DENIAL_MIN_DWELL;
+	verdict = "Denied: the room is full";
+	denial = true;
 }
 
 void AuthStateDeniedFull::logEvent(Record *user){
-	Logger::instance().deniedFull(user->getId());
+	Logger::instance().deniedFull(std::string(user->getId()));
 }
 
 void AuthStateDeniedFull::updateUI(Record *user){
@@ -9,6 +9,9 @@
 
 AuthStateDeniedInvalid::AuthStateDeniedInvalid(){ 
 	duration = 10;
+	minDwell = DENIAL_MIN_DWELL;
+	verdict = "Denied: no proof of vaccination";
+	denial = true;
 }
 
 void AuthStateDeniedInvalid::logEvent(Record *user){
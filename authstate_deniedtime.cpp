@@ -10,10 +10,13 @@
 
 AuthStateDeniedTime::AuthStateDeniedTime(){ 
 	duration = 10;
+	minDwell = DENIAL_MIN_DWELL;
+	verdict = "Denied: final dose less than 14 days ago";
+	denial = true;
 }
 
 void AuthStateDeniedTime::logEvent(Record *user){
-	Logger::instance().deniedDate(user->getId());
+	Logger::instance().deniedDate(std::string(user->getId()));
 }
 
 void AuthStateDeniedTime::updateUI(Record *user){
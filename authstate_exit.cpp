@@ -10,10 +10,11 @@
 
 AuthStateExit::AuthStateExit(){ 
 	duration = 7;
+	verdict = "Goodbye";
 }
 
 void AuthStateExit::logEvent(Record *user){
-	Logger::instance().exit(user->getId());
+	Logger::instance().exit(std::string(user->getId()));
 }
 
 void AuthStateExit::updateUI(Record *user){
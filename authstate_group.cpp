@@ -0,0 +1,64 @@
+/**
+ * AuthState that appears when several users hold up their QR codes together and
+ * they are read from the same frame. Each user is decided on their own, and this
+ * state shows everyone's outcome at once, for as long as the longest of them
+ * would have been shown, instead of one full feedback after another. For more
+ * information, see AuthState class docs.
+ * @brief AuthState for a group of users scanned together.
+ * @author Austin Hatherell
+ */
+
+#include "authstates_header.h"
+
+#include <algorithm>
+
+/**
+ * @brief Constructor.
+ * @param members    The users of the group, with the states they would be shown alone;
+ *                   the group takes ownership of the states.
+ */
+AuthStateGroup::AuthStateGroup(std::vector<GroupMember> members) : members(members){
+	duration = 0;
+	minDwell = 0;
+	verdict = "Group";
+	for(GroupMember &member : this->members){
+		duration = std::max(duration, member.state->getDuration());
+		minDwell = std::max(minDwell, member.state->getMinDwell());
+		denial = denial || member.state->isDenial();
+	}
+}
+
+/**
+ * @brief Deletes the states of the members.
+ */
+AuthStateGroup::~AuthStateGroup(){
+	for(GroupMember &member : members)
+		delete member.state;
+}
+
+void AuthStateGroup::logEvent(Record *user){
+	for(GroupMember &member : members)
+		member.state->logEvent(member.recognized ? &member.user : nullptr);
+}
+
+void AuthStateGroup::updateUI(Record *user){
+	std::string outcomes;
+	for(GroupMember &member : members){
+		std::string name = member.recognized ? member.user.getfName() + " " + member.user.getlName() : "Unrecognized QR code";
+		outcomes += "<p><b>" + name + "</b>: " + member.state->getVerdict() + "</p>";
+	}
+
+	if(denial){
+		ui->setBackgroundColor("#e5877b");
+		ui->setHeading("Not everyone may proceed.");
+		ui->setPrimaryText("Only those accepted or leaving may proceed:");
+		ui->setStatusIcon("resources/denied-circle.png");
+	}else{
+		ui->setBackgroundColor("#83c17c");
+		ui->setHeading("Please proceed.");
+		ui->setPrimaryText("Everyone in your group may proceed:");
+		ui->setStatusIcon("resources/accepted-circle.png");
+	}
+	ui->setSecondaryText(outcomes);
+	ui->setUserName(std::to_string(members.size()) + " QR codes");
+}
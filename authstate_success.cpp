@@ -9,10 +9,11 @@
 
 AuthStateSuccess::AuthStateSuccess(){ 
 	duration = 7;
+	verdict = "Accepted";
 }
 
 void AuthStateSuccess::logEvent(Record *user){
-	Logger::instance().admit(user->getId());
+	Logger::instance().admit(std::string(user->getId()));
 }
 
 void AuthStateSuccess::updateUI(Record *user){
@@ -13,6 +13,8 @@
 
 #include "authstate.h"
 
+#include <vector>
+
 class AuthStateWaiting : public AuthState{
 	public:
 		AuthStateWaiting();
@@ -72,4 +74,25 @@ class AuthStateExit : public AuthState{
 		void updateUI(Record *user=nullptr);
 };
 
+
+// One of the users read together in a frame, see AuthStateGroup
+struct GroupMember {
+	AuthState *state; // The state this user would be shown alone
+	Record user; // The user's record, if recognized
+	bool recognized; // The user's code was found in the database
+};
+
+
+class AuthStateGroup : public AuthState{
+	public:
+		AuthStateGroup(std::vector<GroupMember> members);
+		~AuthStateGroup();
+
+	private:
+		std::vector<GroupMember> members;
+
+		void logEvent(Record *user=nullptr);
+		void updateUI(Record *user=nullptr);
+};
+
 #endif
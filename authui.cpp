@@ -24,7 +24,7 @@ AuthUI* AuthUI::getInstance(){
  * @brief Constructor for AuthUI.
  * @param parent     The widget to set as AuthUI's parent widget
  * */
-AuthUI::AuthUI(QWidget *parent) : QWidget(parent)
+AuthUI::AuthUI(QWidget *parent) : QWidget(parent), scanQueue(SCAN_QUEUE_CAPACITY, SCAN_QUEUE_POLICY), scanFilter(SCAN_REPEAT_WINDOW, SCAN_FILTER_CAPACITY), authWorker(scanQueue, this), decisionCache(DECISION_CACHE_CAPACITY)
 {
 
 	QVBoxLayout *parentLayout = new QVBoxLayout(this); // Top-level layout
@@ -128,6 +128,11 @@ AuthUI::AuthUI(QWidget *parent) : QWidget(parent)
 	occupancyLabel->setAlignment(Qt::AlignCenter);
 	statusSideLayout->addWidget(occupancyLabel);
 
+	throughputLabel = new QLabel(QString::fromStdString("0 scans/min"));
+	throughputLabel->setStyleSheet("font-size: 20px;");
+	throughputLabel->setAlignment(Qt::AlignCenter);
+	statusSideLayout->addWidget(throughputLabel);
+
 	QSpacerItem *spacer4 = new QSpacerItem(0, 0, QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
 	statusSideLayout->addItem(spacer4);
 
@@ -144,6 +149,24 @@ AuthUI::AuthUI(QWidget *parent) : QWidget(parent)
 		// AuthState::AuthState() -> ...
 	instance = this;
 
+	// When a feedback state's minimum duration is over, go back to waiting
+	feedbackTimer = new QTimer(this);
+	feedbackTimer->setSingleShot(true);
+	connect(feedbackTimer, &QTimer::timeout, this, &AuthUI::finishFeedback);
+
+	// In express-lane mode, once a state's minimum dwell is over, a queued scan may replace it
+	dwellTimer = new QTimer(this);
+	dwellTimer->setSingleShot(true);
+	connect(dwellTimer, &QTimer::timeout, this, &AuthUI::finishDwell);
+
+	sessionScans = 0;
+	sessionClock.start();
+
+	// Forget cached decisions about records as soon as they are edited
+	Database::instance().addChangeListener([this](const std::vector<std::string> &ids){
+		decisionCache.invalidate(ids);
+	});
+
 	currentState = nullptr;
 	setState(new AuthStateWaiting);
 	available = true;
@@ -288,79 +311,248 @@ void AuthUI::setOccupancy(int occupancy){
 }
 
 /**
- * This method returns the result of subtracting a date (in YYYY/MM/DD) from
- * the current operating system time, in seconds. It will return negative seconds
- * if the date is in the future.
- * @brief Calculate number of seconds between current system time and some date.
- * @param date    YYYY/MM/DD date string to subtract
- * @return seconds elapsed since date (based on current OS time). If the date is in
-           the future, the date is negative.
+ * This method takes a QR code presented to the scanner (see the method below).
+ * @brief Authenticate a QR code and display feedback in UI.
+ * @param qr    The QR code to check
  */
-int AuthUI::secondsToNow(std::string date){
-	std::time_t currentTime;
-	std::time(&currentTime);
-
-	std::tm givenTime;
-	givenTime.tm_sec = 0;
-	givenTime.tm_min = 0;
-	givenTime.tm_hour = 0;
-	givenTime.tm_year = atoi(date.substr(0, 4).c_str()) - 1900;
-	givenTime.tm_mon = atoi(date.substr(5, 2).c_str()) - 1;
-	givenTime.tm_mday = atoi(date.substr(8, 2).c_str());
-	
-	int difference = (int) std::difftime(currentTime, std::mktime(&givenTime));
-	return difference;
+void AuthUI::authenticate(QRCode qr){
+	authenticate(std::vector<QRCode>(1, qr));
 }
 
 /**
- * This method implements the logic that checks whether the user associated
- * with a QR code should be allowed entry to the room (based on vaccination
- * status and current room occupancy with respect to capacity), then activates
- * an AuthState which handles the visual feedback associated with this use case.
- * @brief Authenticate a QR code and display feedback in UI.
- * @param qr    The QR code to check
+ * This method takes the QR codes read together from one frame, which are
+ * decided together and share a single feedback (see decide()). If no feedback
+ * is on screen they are checked straight away. Otherwise the feedback for the
+ * previous codes is left up for its full duration and these codes are queued,
+ * to be checked as soon as that feedback is over; if too many frames are waiting,
+ * the oldest is dropped. Either way the method returns at once, so the UI never
+ * blocks while feedback is displayed.
+ * In express-lane mode (see config.h), feedback is only held for its minimum dwell:
+ * after that, new codes replace it immediately if any of them lets someone in or
+ * out (see wouldLetThrough()); codes that would all be denied are queued as usual.
+ * @brief Authenticate the QR codes of a frame and display feedback in UI.
+ * @param codes    The QR codes to check
  */
-void AuthUI::authenticate(QRCode qr){
-	available = false;
-	if(Database::instance().findId(qr.getData())){ // If user was found in database
-		Record user = Database::instance().searchById(qr.getData());
-
-		// Check if this user is already an occupant
-		bool found = false;
-		int indexFound = -1;
-		for(int i = 0; i < occupants.size(); i++){
-			if(user == occupants.at(i)){
-				found = true;
-				indexFound = i;
-				break;
-			}
+void AuthUI::authenticate(std::vector<QRCode> codes){
+	if(feedbackTimer->isActive()){
+		#ifdef EXPRESS_LANE
+		// Leave out the codes whose feedback is still on screen
+		codes.erase(std::remove_if(codes.begin(), codes.end(), [this](QRCode &qr){
+			return std::find(shownCodes.begin(), shownCodes.end(), qr.getData()) != shownCodes.end();
+		}), codes.end());
+		if(codes.empty())
+			return;
+		if(!dwellTimer->isActive() && wouldLetThrough(codes)){
+			decide(codes);
+			return;
 		}
+		#endif
+		if(pendingScans.size() >= MAX_PENDING_SCANS)
+			pendingScans.pop_front();
+		pendingScans.push_back(codes);
+		return;
+	}
+	decide(codes);
+}
+
+/**
+ * This method is how the camera hands over the QR codes it recognizes. It is called
+ * from the camera's thread with the codes of one frame, and never waits for the UI:
+ * the codes are put in a queue as a batch, which the authentication worker drains into
+ * authenticate() on the GUI thread whenever AuthUI is available. If codes arrive
+ * faster than that, the queue's policy (SCAN_QUEUE_POLICY in config.h) decides which are kept.
+ * Every sighting is checked against the repeat filter here, before the queue, so a
+ * pass held up while feedback is on screen keeps its window open and is not
+ * authenticated again when the feedback ends. A code seen again within
+ * SCAN_REPEAT_WINDOW seconds is therefore not authenticated again. A code the
+ * queue has no room for is forgotten by the filter, so its next sighting is queued.
+ * @brief Queue the QR codes of a frame for authentication.
+ * @param codes    The QR codes recognized by the camera in one frame.
+ * @return True if any code was queued; false if they were all repeats or were dropped.
+ */
+bool AuthUI::submit(std::vector<QRCode> codes){
+	std::vector<QRCode> admitted;
+	for(QRCode &qr : codes){
+		if(scanFilter.admit(qr))
+			admitted.push_back(qr);
+	}
+	if(admitted.empty())
+		return false;
+
+	std::vector<QRCode> dropped = scanQueue.push(admitted);
+	for(QRCode &qr : dropped)
+		scanFilter.forget(qr);
+	return dropped.size() < admitted.size();
+}
+
+/**
+ * @brief Get the depth and drop counters of the queue fed by submit().
+ * @return The queue's counters.
+ */
+ScanQueueStats AuthUI::getScanQueueStats(){
+	return scanQueue.stats();
+}
+
+/**
+ * The filter is used by the camera's thread (see submit()), so its counters are only
+ * meaningful while the camera is stopped (i.e. outside a session).
+ * @brief Get the hit and suppression counters of the repeated-scan filter.
+ * @return The filter's counters.
+ */
+ScanFilterStats AuthUI::getScanFilterStats(){
+	return scanFilter.stats();
+}
+
+/**
+ * Must be called from the GUI thread, which is the one making decisions.
+ * @brief Get the hit rate and lookup latency counters of the decision cache.
+ * @return The cache's counters.
+ */
+DecisionCacheStats AuthUI::getDecisionCacheStats(){
+	return decisionCache.stats();
+}
+
+/**
+ * This method decides each of the QR codes read together from one frame (see
+ * judge()), then activates an AuthState which handles the visual feedback
+ * associated with this use case. A single code gets the state of its own
+ * outcome; a group gets one AuthStateGroup listing everyone's outcome, shown
+ * for as long as the longest of them rather than one after the other.
+ * @brief Decide whether the QR codes of a frame are admitted and display feedback in UI.
+ * @param codes    The QR codes to check
+ */
+void AuthUI::decide(std::vector<QRCode> codes){
+	shownCodes.clear();
+	std::vector<GroupMember> group(codes.size());
+	for(std::size_t i = 0; i < codes.size(); i++){
+		shownCodes.push_back(codes[i].getData());
+		group[i].state = judge(codes[i], group[i].user, group[i].recognized);
+	}
 
-		if(found){ // If already an occupant, let them exit
-			occupants.erase(occupants.begin() + indexFound);
+	if(group.size() == 1)
+		setState(group[0].state, group[0].recognized ? &group[0].user : nullptr);
+	else
+		setState(new AuthStateGroup(group), nullptr);
+
+	// The waiting state comes back once feedbackTimer runs out (see finishFeedback())
+}
+
+/**
+ * This method implements the logic that checks whether the user associated
+ * with a QR code should be allowed entry to the room (based on vaccination
+ * status and current room occupancy with respect to capacity), and returns
+ * the AuthState for the outcome, which the caller activates.
+ * What the database says about the code comes from the decision cache, so a
+ * returning user is usually decided without a database lookup.
+ * @brief Decide whether a QR code is admitted.
+ * @param qr            The QR code to check
+ * @param user          Receives the user's record, if the code was recognized.
+ * @param recognized    Receives whether the code was found in the database.
+ * @return The new state for the outcome, owned by the caller.
+ */
+AuthState* AuthUI::judge(QRCode qr, Record &user, bool &recognized){
+	countScan();
+	DecisionCache::Decision decision = decisionCache.lookup(qr.getData(), std::time(nullptr), user);
+	recognized = decision != DecisionCache::Unknown;
+	if(recognized){ // If user was found in database
+		// If already an occupant, let them exit
+		if(occupants.erase(user.getKey()) > 0){
 			setOccupancy(occupants.size());
-			setState(new AuthStateExit, &user);
+			return new AuthStateExit;
 		}else if(occupants.size() >= capacity){ // If room full, error
-			setState(new AuthStateDeniedFull, &user);
+			return new AuthStateDeniedFull;
 		}else{
-			// Check if (1209600 secs = 14 days) has passed since vaccination
-			if(secondsToNow(user.getDate()) >= 1209600){
+			// Check if 14 days have passed since vaccination
+			if(decision == DecisionCache::Eligible){
 				// If so, allow entry
-				occupants.push_back(user);
+				occupants.insert(user.getKey());
 				setOccupancy(occupants.size());
-				setState(new AuthStateSuccess, &user);
+				return new AuthStateSuccess;
 			}else{
 				// Otherwise, deny
-				setState(new AuthStateDeniedTime, &user);
+				return new AuthStateDeniedTime;
 			}
 		}
 	}else{ // Deny
-		setState(new AuthStateDeniedInvalid, nullptr);
+		return new AuthStateDeniedInvalid;
+	}
+}
+
+/**
+ * In express-lane mode only codes that move someone through the doorway may cut
+ * the feedback on screen short; a frame that would only be denied waits its turn,
+ * like any other scan. Each code is checked against the room as it is now, and
+ * nothing is changed, so the codes still have to be decided (see decide()).
+ * @brief Check whether any of the QR codes of a frame would admit or let out its user.
+ * @param codes    The QR codes to check
+ * @return True if deciding the codes now would admit or let out someone; false otherwise.
+ */
+bool AuthUI::wouldLetThrough(const std::vector<QRCode> &codes){
+	std::shared_ptr<const RecordStore> records = Database::instance().view();
+	std::time_t now = std::time(nullptr);
+	for(QRCode qr : codes){
+		const Record *entry = records->find(qr.getData());
+		if(entry == nullptr)
+			continue;
+		if(occupants.count(entry->getKey()) > 0) // Would exit
+			return true;
+		if(occupants.size() < capacity && entry->isEligible(now))
+			return true;
 	}
+	return false;
+}
 
-	// Revert to waiting state afterwards
+/**
+ * Called by feedbackTimer once the current feedback state has been on screen
+ * for its minimum duration. Reverts to the waiting state, then checks the
+ * codes of the oldest frame scanned in the meantime, if there are any. If AuthUI is then
+ * available, the authentication worker is woken to hand over the next codes.
+ * @brief End the current feedback state.
+ */
+void AuthUI::finishFeedback(){
+	shownCodes.clear();
 	setState(new AuthStateWaiting);
+	if(!pendingScans.empty()){
+		std::vector<QRCode> next = pendingScans.front();
+		pendingScans.pop_front();
+		decide(next);
+	}
+	authWorker.wake();
+}
+
+/**
+ * Called by dwellTimer once the current feedback state has been on screen for
+ * its minimum dwell. In express-lane mode, the codes of the oldest frame scanned
+ * in the meantime replace it straight away if they let someone in or out (see
+ * wouldLetThrough()); otherwise nothing changes until feedbackTimer runs out.
+ * Either way AuthUI is now available, so the authentication worker is woken.
+ * @brief End the current feedback state's minimum dwell.
+ */
+void AuthUI::finishDwell(){
+	#ifdef EXPRESS_LANE
 	available = true;
+	if(!pendingScans.empty() && wouldLetThrough(pendingScans.front())){
+		std::vector<QRCode> next = pendingScans.front();
+		pendingScans.pop_front();
+		decide(next);
+	}
+	authWorker.wake();
+	#endif
+}
+
+/**
+ * Keeps count of the scans decided during the session, and shows how many were
+ * decided in the last minute. This is the doorway's throughput, which can be
+ * compared with and without express-lane mode (see config.h).
+ * @brief Record a decided scan and update the throughput shown in the UI.
+ */
+void AuthUI::countScan(){
+	qint64 now = sessionClock.elapsed();
+	sessionScans++;
+	recentScans.push_back(now);
+	while(now - recentScans.front() >= 60000)
+		recentScans.pop_front();
+	throughputLabel->setText(QString::number(recentScans.size()) + QString::fromStdString(" scans/min"));
 }
 
 /*
@@ -378,6 +570,8 @@ bool AuthUI::shouldInterruptCamera(){
  * When AuthUI is already displaying feedback for a previously-recognized QR code,
  * it isn't available to accept new input and the camera should disregard whatever
  * it sees durring this time. This method indicates whether AuthUI is available.
+ * In express-lane mode, feedback can be replaced once its minimum dwell is over,
+ * so AuthUI is available again from then on.
  * @brief Ask AuthUI whether it's available to handle QR code input.
  * @return True if AuthUI can receive a QR code; false otherwise.
  */
@@ -400,8 +594,10 @@ AuthState* AuthUI::getAuthState()
 
 /**
  * This sets AuthUI's state to whatever AuthState is passed into the method,
- * then activates that state so that the UI displays the appropriate feedback
- * and blocks for a specified amount of time. Some AuthStates require a user
+ * then activates that state so that the UI displays the appropriate feedback.
+ * A state with a minimum display time starts feedbackTimer, and AuthUI is
+ * unavailable until it runs out; the call itself returns at once, leaving the
+ * event loop free to repaint and handle input. Some AuthStates require a user
  * record in order to properly update the UI (e.g. AuthStateSuccess displays
  * the user's name), so this must also be provided in order to change/activate
  * the state. However, since not all AuthStates require this information
@@ -414,6 +610,23 @@ void AuthUI::setState(AuthState *newState, Record *user){
 	delete currentState;
 	currentState = newState;
 	currentState->activate(user);
+
+	if(currentState->getDuration() > 0){
+		available = false;
+		feedbackTimer->start(currentState->getDuration() * 1000);
+	}else{
+		available = true;
+		feedbackTimer->stop();
+	}
+
+	if(currentState->getMinDwell() > 0){
+		dwellTimer->start(currentState->getMinDwell() * 1000);
+	}else{
+		dwellTimer->stop();
+		#ifdef EXPRESS_LANE
+		available = true;
+		#endif
+	}
 }
 
 /**
@@ -423,8 +636,18 @@ void AuthUI::setState(AuthState *newState, Record *user){
  * @brief Wake up AuthUI.
  */
 void AuthUI::activate(){
-	interruptCamera = true;
+	interruptCamera = false;
 	available = true;
+
+	// Start handing queued codes to authenticate(), forgetting the codes seen last session
+	scanFilter.clear();
+	authWorker.start();
+
+	// Start measuring the throughput of this session
+	sessionScans = 0;
+	recentScans.clear();
+	sessionClock.restart();
+	throughputLabel->setText(QString::fromStdString("0 scans/min"));
 }
 
 /**
@@ -447,8 +670,9 @@ void AuthUI::keyReleaseEvent(QKeyEvent *event){
 			authenticate(QRCode("Hello world!"));
 			break;
 		case 52: // "4" key -- fill the room
-			while(occupants.size() < capacity)
-				occupants.push_back(Record());
+			// Placeholder keys: odd values with the top bit set, which no real id key can have
+			for(std::uint64_t i = 0; occupants.size() < capacity; i++)
+				occupants.insert((1ULL << 63) | (2 * i + 1));
 			setOccupancy(occupants.size());
 			break;
 		case 53: // "5" key -- empty the room
@@ -460,7 +684,9 @@ void AuthUI::keyReleaseEvent(QKeyEvent *event){
 			break;
 	}
 	
-	setState(new AuthStateWaiting);
+	// Leave any feedback on screen until its time is up
+	if(!feedbackTimer->isActive())
+		setState(new AuthStateWaiting);
 }
 
 /**
@@ -477,10 +703,42 @@ void AuthUI::keyReleaseEvent(QKeyEvent *event){
 void AuthUI::toMain()
 {
 	interruptCamera = true;
+	authWorker.stop();
 	Window &switchWindow = Window::getInstance();
 	switchWindow.setState("main");
+	pendingScans.clear();
+	setState(new AuthStateWaiting);
 	occupants.clear();
 	setOccupancy(occupants.size());
 	Logger::instance().end();
+
+	// Report the session's overall throughput
+	double minutes = sessionClock.elapsed() / 60000.0;
+	#ifdef EXPRESS_LANE
+	std::string mode = "express lane";
+	#else
+	std::string mode = "standard";
+	#endif
+	std::cout << "Session throughput: " << (minutes > 0 ? sessionScans / minutes : 0) << " scans/min ("
+	          << sessionScans << " scans in " << minutes << " min, " << mode << " mode)" << std::endl;
+
+	// Report how the scan queue coped, then empty it for the next session
+	ScanQueueStats queueStats = scanQueue.stats();
+	std::cout << "Scan queue: " << queueStats.pushed << " queued, " << queueStats.dropped << " dropped ("
+	          << queueStats.duplicates << " duplicates), peak depth " << queueStats.maxDepth << std::endl;
+	ScanFilterStats filterStats = scanFilter.stats();
+	std::cout << "Repeat filter: " << filterStats.checked << " checked, " << filterStats.hits << " hits, "
+	          << filterStats.suppressed << " suppressed, " << filterStats.evicted << " evicted" << std::endl;
+
+	// Report how well the decision cache served returning users, over every session so far
+	DecisionCacheStats cacheStats = decisionCache.stats();
+	std::cout << "Decision cache: " << cacheStats.hits << "/" << cacheStats.lookups << " hits, "
+	          << (cacheStats.hits > 0 ? cacheStats.hitNanos / cacheStats.hits : 0) << " ns per hit, "
+	          << (cacheStats.misses > 0 ? cacheStats.missNanos / cacheStats.misses : 0) << " ns per miss, "
+	          << cacheStats.expired << " expired, " << cacheStats.invalidated << " invalidated, "
+	          << cacheStats.evicted << " evicted" << std::endl;
+	std::vector<QRCode> leftover;
+	while(scanQueue.tryPop(leftover)){
+	}
 }
 
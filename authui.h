@@ -10,6 +10,11 @@
 #define AUTHUI_H
 
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <unordered_set>
+#include <cstdint>
+#include <atomic>
 #include <iostream>
 #include <ctime>
 #include <string>
@@ -26,6 +31,8 @@
 #include <QKeyEvent>
 #include <QPixmap>
 #include <QMovie>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include "window.h"
 #include "record.h"
@@ -33,6 +40,11 @@
 #include "authstates_header.h"
 #include "qrcode.h"
 #include "logger.h"
+#include "scanqueue.h"
+#include "scanfilter.h"
+#include "decisioncache.h"
+#include "authworker.h"
+#include "config.h"
 
 class AuthState; // Forward declaration
 
@@ -48,6 +60,11 @@ class AuthUI : public QWidget{
 		void setStatusIcon(std::string location);
 
 		void authenticate(QRCode qr);
+		void authenticate(std::vector<QRCode> codes);
+		bool submit(std::vector<QRCode> codes);
+		ScanQueueStats getScanQueueStats();
+		ScanFilterStats getScanFilterStats();
+		DecisionCacheStats getDecisionCacheStats();
 		void activate();
 		bool shouldInterruptCamera();
 		bool isAvailable();
@@ -59,15 +76,29 @@ class AuthUI : public QWidget{
 
 	private:
 		int capacity;
-		bool interruptCamera;
-		bool available;
-		std::vector<Record> occupants;
+		std::atomic<bool> interruptCamera; // Read by the camera thread
+		std::atomic<bool> available; // Read by the authentication worker
+		ScanQueue scanQueue; // Codes from the camera, waiting to be authenticated
+		ScanFilter scanFilter; // Turns away codes the camera keeps seeing; only used by the camera's thread
+		AuthWorker authWorker; // Hands the codes in scanQueue to authenticate()
+		std::unordered_set<std::uint64_t> occupants; // Record::getKey() of every user in the room
+		DecisionCache decisionCache; // Recent ids and what the database says about them
 		AuthState *currentState;
+		QTimer *feedbackTimer; // Runs while a state is held on screen for its minimum duration
+		QTimer *dwellTimer; // Runs while a state may not yet be replaced in express-lane mode
+		QElapsedTimer sessionClock; // Time since the authentication session started
+		std::deque<qint64> recentScans; // sessionClock times of the scans decided in the last minute
+		std::size_t sessionScans; // Scans decided since the session started
+		std::deque<std::vector<QRCode>> pendingScans; // The codes of each frame scanned while feedback was on screen, oldest first
+		std::vector<std::string> shownCodes; // The codes whose feedback is on screen
+
+		static const std::size_t MAX_PENDING_SCANS = 8; // Older scans are dropped beyond this
 
 		QLabel *heading;
 		QLabel *primaryText;
 		QLabel *secondaryText;
 		QLabel *occupancyLabel;
+		QLabel *throughputLabel;
 		QLabel *userNameLabel, *userStudentNumberLabel;
 		QLabel *statusIconLabel;
 		QFrame *statusSideFrame;
@@ -76,8 +107,13 @@ class AuthUI : public QWidget{
 		AuthState* getAuthState();
 
 		void setState(AuthState *newState, Record *user=nullptr);
+		void decide(std::vector<QRCode> codes);
+		AuthState* judge(QRCode qr, Record &user, bool &recognized);
+		bool wouldLetThrough(const std::vector<QRCode> &codes);
+		void finishFeedback();
+		void finishDwell();
+		void countScan();
 		void setOccupancy(int occupancy);
-		int secondsToNow(std::string date);
 		void keyReleaseEvent(QKeyEvent *event);
 		void toMain();
 		static AuthUI *instance;
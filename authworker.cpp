@@ -0,0 +1,107 @@
+/**
+ * AuthWorker class. It runs the consuming side of the scan pipeline: the camera pushes
+ * decoded codes into a ScanQueue from its own thread, and this worker drains the queue on
+ * another, handing the codes of each frame to AuthUI on the GUI thread through a queued call. AuthUI's
+ * decisions and feedback therefore stay on the GUI thread, while neither the camera nor
+ * the GUI ever waits for the other.
+ * The worker only takes codes out of the queue once AuthUI is available and has handled
+ * the previous ones, so while feedback is on screen new codes wait in the queue, where its
+ * backpressure policy decides which are kept. Until then the worker sleeps, and it is
+ * woken when AuthUI becomes available (see wake()) or, if the queue is empty, when a
+ * code arrives; it never polls.
+ * @brief Feeds queued QR codes to AuthUI.
+ * @author Austin Hatherell
+ */
+
+#include "authworker.h"
+#include "authui.h"
+
+/**
+ * Constructor
+ * The worker does nothing until start() is called.
+ * @brief Creates a worker for a queue.
+ * @param queue   The queue to drain.
+ * @param ui      The AuthUI to hand the codes to.
+ */
+AuthWorker::AuthWorker(ScanQueue &queue, AuthUI *ui) : queue(queue), ui(ui){
+	running = false;
+	inFlight = false;
+	session = 0;
+}
+
+/**
+ * The queue is reopened, so the worker and the camera can wait on it again.
+ * @brief Start draining the queue on a new thread.
+ */
+void AuthWorker::start(){
+	if(running)
+		return;
+	running = true;
+	inFlight = false; // A code posted before the last stop() is dropped without clearing it
+	queue.reopen();
+	thread = std::thread(&AuthWorker::run, this, session.load());
+}
+
+/**
+ * The queue is closed, which releases the worker if it is waiting for a code, and a
+ * camera thread blocked pushing one. Codes left in the queue stay there. A code already
+ * posted to AuthUI but not yet handled by the GUI thread is dropped, so nothing is
+ * authenticated once the session is over, even if the GUI thread only gets to it after
+ * the room has been emptied.
+ * @brief Stop draining the queue and wait for the worker thread to finish.
+ */
+void AuthWorker::stop(){
+	running = false;
+	session++;
+	queue.close();
+	wake();
+	if(thread.joinable())
+		thread.join();
+}
+
+/**
+ * AuthUI calls this whenever it may have become available: when feedback ends or can
+ * be replaced, and once it has handled the codes the worker posted.
+ * @brief Wake the worker if it is waiting for AuthUI.
+ */
+void AuthWorker::wake(){
+	{
+		std::lock_guard<std::mutex> guard(waitLock);
+	}
+	ready.notify_one();
+}
+
+/**
+ * The worker sleeps until AuthUI can take a code, then until the queue has codes for it.
+ * @brief The worker thread's loop.
+ * @param token   The session the worker was started for; codes it posts are dropped once stop() changes it.
+ */
+void AuthWorker::run(unsigned token){
+	while(running){
+		{
+			std::unique_lock<std::mutex> guard(waitLock);
+			ready.wait(guard, [this]{ return !running || (!inFlight && ui->isAvailable()); });
+		}
+
+		std::vector<QRCode> codes;
+		if(!running || !queue.pop(codes))
+			break; // Stopped, which closes the queue
+
+		inFlight = true;
+		QMetaObject::invokeMethod(ui, [this, codes, token]{
+			if(session != token) // Posted before stop(), for a session that is over
+				return;
+			ui->authenticate(codes);
+			inFlight = false;
+			wake();
+		}, Qt::QueuedConnection);
+	}
+}
+
+/**
+ * Destructor
+ * @brief Stops the worker thread.
+ */
+AuthWorker::~AuthWorker(){
+	stop();
+}
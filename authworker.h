@@ -0,0 +1,41 @@
+/**
+ * Header for the AuthWorker class, which feeds codes from the scan queue to AuthUI.
+ * @brief The header file for the authworker class.
+ * @author Austin Hatherell
+ */
+
+#ifndef AUTHWORKER_H
+#define AUTHWORKER_H
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "scanqueue.h"
+
+class AuthUI; // Forward declaration
+
+class AuthWorker{
+	public:
+		AuthWorker(ScanQueue &queue, AuthUI *ui);
+		~AuthWorker();
+
+		void start();
+		void stop();
+		void wake();
+
+	private:
+		ScanQueue &queue;
+		AuthUI *ui;
+		std::thread thread;
+		std::atomic<bool> running;
+		std::atomic<bool> inFlight; // Codes have been posted to AuthUI and not handled yet
+		std::atomic<unsigned> session; // Changed by stop(), so codes posted before it are dropped
+		std::mutex waitLock;
+		std::condition_variable ready; // Signalled when AuthUI may be able to take a code (see wake())
+
+		void run(unsigned token);
+};
+
+#endif
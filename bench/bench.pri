@@ -0,0 +1,8 @@
+# Settings shared by the benchmarks. Each one is a console program built from the database
+# sources alone, so it needs neither Qt nor a camera.
+TEMPLATE = app
+CONFIG  += console c++17 release thread
+CONFIG  -= qt app_bundle
+INCLUDEPATH += $$PWD/.. $$PWD
+SOURCES  += $$PWD/benchrecords.cpp $$PWD/../record.cpp $$PWD/../namepool.cpp $$PWD/../bloomfilter.cpp $$PWD/../recordstore.cpp
+HEADERS  += $$PWD/benchrecords.h $$PWD/../record.h $$PWD/../namepool.h $$PWD/../bloomfilter.h $$PWD/../recordstore.h $$PWD/../sharedvector.h $$PWD/../sharedmap.h
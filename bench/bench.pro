@@ -0,0 +1,4 @@
+# Benchmarks of the database layer. Build with `qmake && make` in this directory, then run
+# each program from its own directory (e.g. lookup/lookup).
+TEMPLATE = subdirs
+SUBDIRS  += lookup footprint stress eligibility
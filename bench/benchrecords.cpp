@@ -0,0 +1,76 @@
+/**
+ * Records for the benchmarks to work on, shaped like a campus roster: numeric student ids,
+ * names drawn from a few hundred common first and last names, and second doses spread over
+ * the year the vaccines were rolled out.
+ * @brief Builds rosters of made-up records for the benchmarks.
+ * @author Justin Teichman
+ * */
+#include <benchrecords.h>
+#include <chrono>
+
+static const char *FIRST_NAMES[] = {"alice", "bob", "carol", "dave", "erin", "frank", "grace", "heidi",
+                                    "ivan", "judy", "mallory", "niaj", "olivia", "peggy", "rupert", "sybil",
+                                    "trent", "victor", "walter", "yasmin"};
+static const char *LAST_NAMES[] = {"abernathy", "blackburn", "chen", "dubois", "evans", "fischer", "garcia",
+                                   "haddad", "ito", "jensen", "kowalski", "lee", "martin", "nguyen", "okafor",
+                                   "patel", "quinn", "rossi", "smith", "tremblay"};
+static const std::size_t FIRST_COUNT = sizeof(FIRST_NAMES) / sizeof(FIRST_NAMES[0]);
+static const std::size_t LAST_COUNT = sizeof(LAST_NAMES) / sizeof(LAST_NAMES[0]);
+
+// Day number of 2021.01.01, and how many days of doses follow it
+static const std::int32_t FIRST_DOSE_DAY = 18628;
+static const std::int32_t DOSE_DAYS = 365;
+
+/**
+ * Record i has id benchId(i). Its names and date are picked from i by strides coprime with
+ * the table sizes, so every combination turns up and none follows its neighbour.
+ * @brief Makes a roster of records.
+ * @param count The number of records to make.
+ * @return The records, with ids numbered from FIRST_BENCH_ID.
+ * */
+std::vector<Record> makeRecords(std::size_t count){
+    std::vector<Record> recs;
+    recs.reserve(count);
+    for(std::size_t i = 0; i < count; i++){
+        std::string day = Record::formatDay(FIRST_DOSE_DAY + static_cast<std::int32_t>(i * 7 % DOSE_DAYS));
+        recs.emplace_back(benchId(i), FIRST_NAMES[i % FIRST_COUNT], LAST_NAMES[i * 3 / FIRST_COUNT % LAST_COUNT], day);
+    }
+    return recs;
+}
+
+/**
+ * @brief Replaces the contents of a store with a roster of records (see makeRecords()).
+ * @param store The store to fill.
+ * @param count The number of records to put in it.
+ * */
+void fillStore(RecordStore& store, std::size_t count){
+    std::vector<std::vector<Record>> parts(1);
+    parts[0] = makeRecords(count);
+    store.load(parts);
+}
+
+/**
+ * @brief Returns the id of a record made by makeRecords().
+ * @param index The position of the record in the roster.
+ * @return Its id.
+ * */
+std::string benchId(std::size_t index){
+    return std::to_string(FIRST_BENCH_ID + index);
+}
+
+/**
+ * @brief Returns a steady clock reading, to be passed to elapsedNanoseconds().
+ * @return The current time, in nanoseconds.
+ * */
+std::uint64_t now(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Returns the time since a reading taken with now().
+ * @param start The earlier reading.
+ * @return The nanoseconds elapsed since it.
+ * */
+double elapsedNanoseconds(std::uint64_t start){
+    return static_cast<double>(now() - start);
+}
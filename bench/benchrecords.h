@@ -0,0 +1,25 @@
+/**
+ * The header file for the records shared by the benchmarks.
+ * @brief The header file for benchrecords.cpp.
+ * @author Justin Teichman
+ * */
+
+#ifndef BENCHRECORDS_H
+#define BENCHRECORDS_H
+
+#include <record.h>
+#include <recordstore.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Id of the first record made by makeRecords(); ids are numbered on from it
+const std::uint64_t FIRST_BENCH_ID = 250000000;
+
+std::vector<Record> makeRecords(std::size_t count);
+void fillStore(RecordStore& store, std::size_t count);
+std::string benchId(std::size_t index);
+double elapsedNanoseconds(std::uint64_t start);
+std::uint64_t now();
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * Measures the cost of deciding whether a scanned user has been vaccinated long enough to be
+ * admitted. The scanner used to work out the seconds since the user's dose date on every scan,
+ * taking the date string apart with substr and atoi and converting it with mktime; it now
+ * compares the current time with the moment the record became eligible, which is worked out
+ * once when the record's date is set. Both are timed on the same records, half of them dosed
+ * within the last four weeks so that both answers come up, and must reach the same decisions.
+ * Run as `eligibility [decisions]`; the number of decisions defaults to 2M.
+ * @brief Benchmark of the admission check on vaccination dates.
+ * @author Justin Teichman
+ * */
+#include <benchrecords.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <ctime>
+#include <cstdlib>
+
+// Records the decisions are made on, in turn
+static const std::size_t RECORDS = 1000;
+
+/**
+ * The check the scanner made before eligibility was precomputed, kept here as it was except
+ * that tm_isdst is set, which the original left uninitialised.
+ * @brief Calculate number of seconds between current system time and some date.
+ * @param date YYYY.MM.DD date string to subtract
+ * @return seconds elapsed since date (based on current OS time). If the date is in
+ *         the future, the date is negative.
+ * */
+static int secondsToNow(std::string date){
+    std::time_t currentTime;
+    std::time(&currentTime);
+
+    std::tm givenTime;
+    givenTime.tm_sec = 0;
+    givenTime.tm_min = 0;
+    givenTime.tm_hour = 0;
+    givenTime.tm_year = atoi(date.substr(0, 4).c_str()) - 1900;
+    givenTime.tm_mon = atoi(date.substr(5, 2).c_str()) - 1;
+    givenTime.tm_mday = atoi(date.substr(8, 2).c_str());
+    givenTime.tm_isdst = -1;
+
+    int difference = (int) std::difftime(currentTime, std::mktime(&givenTime));
+    return difference;
+}
+
+int main(int argc, char **argv){
+
+    std::size_t decisions = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    std::vector<Record> recs = makeRecords(RECORDS);
+    std::int32_t today = static_cast<std::int32_t>(std::time(nullptr) / (24 * 60 * 60));
+    for(std::size_t i = 0; i < recs.size(); i += 2){
+        recs[i].setDate(Record::formatDay(today - static_cast<std::int32_t>(i / 2 % 28)));
+    }
+
+    std::size_t oldAdmitted = 0;
+    std::uint64_t start = now();
+    for(std::size_t i = 0; i < decisions; i++){
+        oldAdmitted += secondsToNow(std::string(recs[i % RECORDS].getDate())) >= 1209600;
+    }
+    double oldCost = elapsedNanoseconds(start) / decisions;
+
+    std::size_t admitted = 0;
+    start = now();
+    for(std::size_t i = 0; i < decisions; i++){
+        admitted += recs[i % RECORDS].isEligible(std::time(nullptr));
+    }
+    double cost = elapsedNanoseconds(start) / decisions;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "seconds since the date, per scan: " << std::setw(10) << oldCost << " ns" << std::endl
+              << "precomputed eligibility:          " << std::setw(10) << cost << " ns" << std::endl
+              << admitted << " of " << decisions << " decisions admitted the user" << std::endl;
+    if(admitted != oldAdmitted){
+        std::cout << "error: the old check admitted " << oldAdmitted << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,3 @@
+include(../bench.pri)
+TARGET   = eligibility
+SOURCES  += eligibility.cpp
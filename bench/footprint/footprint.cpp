@@ -0,0 +1,104 @@
+/**
+ * Measures the memory a roster takes: as plain records, as a loaded record store with all
+ * of its indexes, and, for comparison, as records holding four std::strings each, the way
+ * records were kept before they were made compact. Memory is read from the allocator, so
+ * every allocation counts, including the allocator's own overhead.
+ * It also checks that reading every field of a record allocates nothing.
+ * Run as `footprint [records]`; the roster defaults to 1M records.
+ * @brief Benchmark of the memory used per record.
+ * @author Justin Teichman
+ * */
+#include <benchrecords.h>
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+// Calls to operator new, to check the record getters make none
+static std::atomic<std::size_t> allocations(0);
+
+void* operator new(std::size_t size){
+    allocations++;
+    void *block = std::malloc(size > 0 ? size : 1);
+    if(block == nullptr){
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void *block) noexcept{
+    std::free(block);
+}
+
+void operator delete(void *block, std::size_t) noexcept{
+    std::free(block);
+}
+
+// A record as it was kept before: four strings of its own
+struct StringRecord {
+    std::string id;
+    std::string first;
+    std::string last;
+    std::string date;
+};
+
+/**
+ * @brief Returns the bytes the allocator has handed out and not had back.
+ * @return The bytes in use on the heap.
+ * */
+static std::size_t heapBytes(){
+    return mallinfo2().uordblks + mallinfo2().hblkhd;
+}
+
+/**
+ * @brief Prints a line of the report.
+ * @param what What was measured.
+ * @param bytes The memory it takes.
+ * @param count The number of records it holds.
+ * */
+static void report(const char *what, std::size_t bytes, std::size_t count){
+    std::cout << std::left << std::setw(40) << what << std::right << std::setw(14) << bytes
+              << std::setw(10) << std::fixed << std::setprecision(1) << static_cast<double>(bytes) / count << std::endl;
+}
+
+int main(int argc, char **argv){
+
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::cout << std::left << std::setw(40) << "" << std::right << std::setw(14) << "bytes" << std::setw(10) << "/record" << std::endl;
+
+    std::size_t before = heapBytes();
+    {
+        std::vector<StringRecord> strings;
+        strings.reserve(count);
+        for(const Record& rec : makeRecords(count)){
+            strings.push_back({std::string(rec.getId()), rec.getfName(), rec.getlName(), std::string(rec.getDate())});
+        }
+        report("four strings per record", heapBytes() - before, count);
+    }
+
+    before = heapBytes();
+    std::vector<Record> recs = makeRecords(count);
+    report("compact records (incl. name pool)", heapBytes() - before, count);
+    recs = std::vector<Record>();
+
+    before = heapBytes();
+    RecordStore store;
+    fillStore(store, count);
+    report("record store (records and indexes)", heapBytes() - before, count);
+
+    // Read every field of every record, including an id too long for a string's inline
+    // buffer, and count the allocations that takes
+    store.insert(Record("student-00000000000000000000000001", "alice", "abernathy", "some time in 2021"));
+    store.insert(Record("999999999999999999", "bob", "blackburn", "2021.06.01"));
+    std::size_t characters = 0;
+    std::size_t start = allocations;
+    for(RecordStore::Slot slot = 0; slot < store.size(); slot++){
+        const Record& rec = store.at(slot);
+        characters += rec.getId().view().size() + rec.getfName().size() + rec.getlName().size() + rec.getDate().view().size();
+    }
+    std::cout << "allocations reading " << store.size() << " records (" << characters << " characters): "
+              << allocations - start << std::endl;
+    return 0;
+}
@@ -0,0 +1,3 @@
+include(../bench.pri)
+TARGET   = footprint
+SOURCES  += footprint.cpp
@@ -0,0 +1,103 @@
+/**
+ * Measures how long an id lookup takes as the record store grows from 1k to 10M records,
+ * to check that it stays flat. Each size is timed on ids the store holds and on ids it
+ * does not (a foreign QR code). The linear scan the database made before it had an id
+ * index is timed alongside, on the sizes where it still finishes in reasonable time.
+ * Run as `lookup [largest size]`; the largest size defaults to 10M records.
+ * @brief Benchmark of id lookups against the size of the record store.
+ * @author Justin Teichman
+ * */
+#include <benchrecords.h>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+
+// Lookups timed at every size, and the largest store the linear scan is timed on
+static const std::size_t LOOKUPS = 1000000;
+static const std::size_t MAX_SCANNED = 1000000;
+
+/**
+ * @brief Times LOOKUPS finds of the given ids.
+ * @param store The store to search.
+ * @param ids The ids to look up, in order.
+ * @param found Incremented for every id found.
+ * @return The nanoseconds taken per lookup.
+ * */
+static double timeFind(const RecordStore& store, const std::vector<std::string>& ids, std::size_t& found){
+    std::uint64_t start = now();
+    for(const std::string& id : ids){
+        found += store.find(id) != nullptr;
+    }
+    return elapsedNanoseconds(start) / ids.size();
+}
+
+/**
+ * Compares the keys of the records rather than their id text, which makes the scan
+ * faster than the one it stands for; the comparison with the index is a generous one.
+ * @brief Times finding ids by walking every record.
+ * @param store The store to search.
+ * @param ids The ids to look up, of which enough are used to take about a second.
+ * @return The nanoseconds taken per lookup.
+ * */
+static double timeScan(const RecordStore& store, const std::vector<std::string>& ids){
+    std::size_t count = std::max<std::size_t>(1, std::min(ids.size(), 200000000 / store.size()));
+    std::vector<Record> recs = store.records();
+    std::size_t found = 0;
+    std::uint64_t start = now();
+    for(std::size_t i = 0; i < count; i++){
+        std::uint64_t key;
+        Record::idKey(ids[i], key);
+        for(const Record& rec : recs){
+            if(rec.getKey() == key){
+                found++;
+                break;
+            }
+        }
+    }
+    double perLookup = elapsedNanoseconds(start) / count;
+    return found == count ? perLookup : -1;
+}
+
+int main(int argc, char **argv){
+
+    std::size_t largest = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    std::mt19937_64 random(42);
+
+    std::cout << std::setw(10) << "records" << std::setw(14) << "hit (ns)" << std::setw(14) << "miss (ns)"
+              << std::setw(14) << "scan (ns)" << std::setw(12) << "build (s)" << std::endl;
+
+    for(std::size_t size = 1000; size <= largest; size *= 10){
+
+        std::uint64_t start = now();
+        RecordStore store;
+        fillStore(store, size);
+        double buildSeconds = elapsedNanoseconds(start) / 1e9;
+
+        std::vector<std::string> hits, misses;
+        hits.reserve(LOOKUPS);
+        misses.reserve(LOOKUPS);
+        for(std::size_t i = 0; i < LOOKUPS; i++){
+            hits.push_back(benchId(random() % size));
+            misses.push_back(benchId(largest + random() % largest));
+        }
+
+        std::size_t found = 0;
+        double hit = timeFind(store, hits, found);
+        double miss = timeFind(store, misses, found);
+        if(found != LOOKUPS){
+            std::cout << "error: " << found << " of " << LOOKUPS << " ids found" << std::endl;
+            return 1;
+        }
+
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(1) << std::setw(14) << hit << std::setw(14) << miss;
+        if(size <= MAX_SCANNED){
+            std::cout << std::setw(14) << timeScan(store, hits);
+        }else{
+            std::cout << std::setw(14) << "-";
+        }
+        std::cout << std::setprecision(2) << std::setw(12) << buildSeconds << std::endl;
+    }
+    return 0;
+}
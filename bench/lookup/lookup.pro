@@ -0,0 +1,3 @@
+include(../bench.pri)
+TARGET   = lookup
+SOURCES  += lookup.cpp
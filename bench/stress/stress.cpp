@@ -0,0 +1,157 @@
+/**
+ * Runs readers against the database while it is being changed, the way the scanner reads it
+ * while an administrator edits records. Reader threads look records up and query them from
+ * views, checking that every view is consistent, while one writer edits, deletes and adds
+ * records back through the Database. It reports how long each change took, which should not
+ * grow with the size of the roster, since a change only copies the parts of the store it
+ * touches. Build it with -fsanitize=thread to have the sanitizer check for data races.
+ * The database works on the files in a fresh temporary directory, which is deleted afterwards.
+ * Run as `stress [records] [rounds]`; the roster defaults to 100k records and the writer to
+ * 1000 rounds of an edit, a deletion and an addition.
+ * The program exits with status 1 if any check failed.
+ * @brief Stress test of concurrent reads and changes of the database.
+ * @author Justin Teichman
+ * */
+#include <benchrecords.h>
+#include <database.h>
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+#include <dirent.h>
+
+// Threads reading the database while the writer changes it
+static const int READERS = 4;
+
+// Checks that failed, and the number of them reported in full
+static std::atomic<std::size_t> failures(0);
+static const std::size_t MAX_REPORTED = 10;
+
+// Temporary directory holding the database files
+static char directory[] = "/tmp/vaxstressXXXXXX";
+
+/**
+ * @brief Records the outcome of a check, reporting the first few that fail.
+ * @param passed Whether the check passed.
+ * @param what What was checked.
+ * */
+static void check(bool passed, const char *what){
+    if(!passed && failures++ < MAX_REPORTED){
+        std::cerr << "check failed: " << what << std::endl;
+    }
+}
+
+/**
+ * Registered before the database is created, so it runs after the database has let go of them.
+ * @brief Deletes the temporary directory and the database files in it.
+ * */
+static void removeDirectory(){
+    DIR *dir = opendir(directory);
+    if(dir != nullptr){
+        while(dirent *entry = readdir(dir)){
+            std::string name = entry->d_name;
+            if(name != "." && name != ".."){
+                std::remove((std::string(directory) + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(directory);
+}
+
+/**
+ * Each view must hold every record but the one the writer may have deleted, find each
+ * record it holds under its own id, and return it from a query by id.
+ * @brief Reads random records from views of the database until told to stop.
+ * @param count The number of records in the roster.
+ * @param seed The seed of the ids looked up.
+ * @param stop Set once the writer is done.
+ * @param reads Incremented for every record read.
+ * */
+static void readRecords(std::size_t count, unsigned seed, const std::atomic<bool>& stop, std::atomic<std::size_t>& reads){
+    Database& db = Database::instance();
+    std::uint64_t state = seed;
+    while(!stop){
+        std::shared_ptr<const RecordStore> view = db.view();
+        check(view->size() + 1 >= count && view->size() <= count, "view holds the roster");
+        for(int i = 0; i < 100; i++){
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            std::string id = benchId((state >> 33) % count);
+            const Record *rec = view->find(id);
+            if(rec != nullptr){
+                check(rec->getId().view() == id, "found record has the id looked up");
+                std::vector<Record> matches = view->query(id, "", "", "");
+                check(matches.size() == 1 && matches[0] == *rec, "query by id returns the record");
+                std::vector<Record> same = view->query("", rec->getfName(), rec->getlName(), std::string(rec->getDate()));
+                check(std::find(same.begin(), same.end(), *rec) != same.end(), "query by fields returns the record");
+            }
+            reads++;
+        }
+    }
+}
+
+int main(int argc, char **argv){
+
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    rounds = std::min(rounds, count);
+
+    if(mkdtemp(directory) == nullptr || chdir(directory) != 0){
+        std::cerr << "cannot create a temporary directory" << std::endl;
+        return 1;
+    }
+    std::atexit(removeDirectory);
+    {
+        std::ofstream text("vaxData.txt");
+        for(const Record& rec : makeRecords(count)){
+            text << rec.getId().view() << ',' << rec.getfName() << ',' << rec.getlName() << ',' << rec.getDate().view() << '\n';
+        }
+    }
+
+    Database& db = Database::instance();
+    check(db.view()->size() == count, "database loads the roster");
+
+    std::atomic<bool> stop(false);
+    std::atomic<std::size_t> reads(0);
+    std::vector<std::thread> readers;
+    for(int i = 0; i < READERS; i++){
+        readers.emplace_back(readRecords, count, i + 1, std::cref(stop), std::ref(reads));
+    }
+
+    // Each round edits a record, deletes it and adds it back, timing every change
+    double total = 0, slowest = 0;
+    auto timed = [&](bool (*change)(Database&, const Record&), const Record& rec, const char *what){
+        std::uint64_t start = now();
+        bool done = change(db, rec);
+        double elapsed = elapsedNanoseconds(start);
+        total += elapsed;
+        slowest = std::max(slowest, elapsed);
+        check(done, what);
+    };
+    for(std::size_t i = 0; i < rounds; i++){
+        std::string id = benchId(i * (count / rounds));
+        timed([](Database& db, const Record& rec){ return db.editRecord(db.searchById(std::string(rec.getId())), rec); },
+              Record(id, "edited", "stress", "2021.06.01"), "record is edited");
+        timed([](Database& db, const Record& rec){ return db.deleteUser(std::string(rec.getId())); },
+              Record(id, "edited", "stress", "2021.06.01"), "record is deleted");
+        timed([](Database& db, const Record& rec){ return db.addUser(rec); },
+              Record(id, "added", "stress", "2021.06.02"), "record is added back");
+    }
+    stop = true;
+    for(std::thread& reader : readers){
+        reader.join();
+    }
+
+    check(db.view()->size() == count, "database holds the roster again");
+    check(db.query("", "added", "stress", "").size() == rounds, "added records are found by name");
+    delete &db;
+
+    std::cout << count << " records, " << rounds << " rounds: " << reads << " records read; changes took "
+              << total / (3 * rounds) / 1000 << " us on average, " << slowest / 1000 << " us at most" << std::endl;
+    std::cout << (failures == 0 ? "passed" : "FAILED") << " (" << failures << " failed checks)" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,4 @@
+include(../bench.pri)
+TARGET   = stress
+SOURCES  += stress.cpp $$PWD/../../database.cpp $$PWD/../../journal.cpp $$PWD/../../snapshot.cpp $$PWD/../../mappedfile.cpp
+HEADERS  += $$PWD/../../database.h $$PWD/../../journal.h $$PWD/../../snapshot.h $$PWD/../../mappedfile.h
@@ -0,0 +1,138 @@
+/**
+ * A bloom filter over strings.
+ * Each string added sets a few bits picked by hashing it. A string whose bits are not all set
+ * was certainly never added, so it can be turned away after a handful of bit tests, without
+ * touching any hash table. A string whose bits are all set was probably added, but may be a
+ * false positive, so it still has to be looked up for certain.
+ * Strings cannot be taken back out of the filter; the owner rebuilds it with reset() when
+ * too many of its entries are stale or it holds more than its capacity.
+ * @brief A compact, probabilistic set of strings.
+ * @author Justin Teichman
+ * */
+#include <bloomfilter.h>
+#include <functional>
+#include <cmath>
+
+/**
+ * Constructor
+ * @brief Creates an empty filter with no capacity; reset() must be called before it is used.
+ * */
+BloomFilter::BloomFilter(){
+    bitCount = 0;
+    entries = 0;
+    limit = 0;
+    setBits = 0;
+}
+
+/**
+ * Empties the filter and sizes it for the given number of entries.
+ * @brief Clears the filter.
+ * @param capacity The number of entries the filter should hold at its intended false positive rate.
+ * */
+void BloomFilter::reset(std::size_t capacity){
+    limit = capacity > 0 ? capacity : 1;
+    words.clear();
+    words.resize((limit * BITS_PER_ENTRY + 63) / 64);
+    bitCount = words.size() * 64;
+    entries = 0;
+    setBits = 0;
+}
+
+/**
+ * @brief Adds a string to the filter.
+ * @param text The string to add.
+ * */
+void BloomFilter::add(std::string_view text){
+
+    std::uint64_t h1, h2;
+    hash(text, h1, h2);
+    for(int i = 0; i < HASHES; i++){
+        std::uint64_t bit = (h1 + i * h2) % bitCount;
+        std::uint64_t mask = 1ULL << (bit % 64);
+        if(!(words[bit / 64] & mask)){
+            words.edit(bit / 64) |= mask;
+            setBits++;
+        }
+    }
+    entries++;
+}
+
+/**
+ * @brief Checks whether a string may have been added to the filter.
+ * @param text The string to check.
+ * @return false if the string was certainly never added, true if it probably was.
+ * */
+bool BloomFilter::mightContain(std::string_view text) const{
+
+    if(bitCount == 0){
+        return false;
+    }
+    std::uint64_t h1, h2;
+    hash(text, h1, h2);
+    for(int i = 0; i < HASHES; i++){
+        std::uint64_t bit = (h1 + i * h2) % bitCount;
+        if(!(words[bit / 64] & (1ULL << (bit % 64)))){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the number of strings added since the filter was last reset.
+ * @return The number of entries, including any the owner no longer holds.
+ * */
+std::size_t BloomFilter::count() const{
+    return entries;
+}
+
+/**
+ * @brief Returns the number of entries the filter was sized for.
+ * @return The capacity passed to the last reset().
+ * */
+std::size_t BloomFilter::capacity() const{
+    return limit;
+}
+
+/**
+ * @brief Returns the memory taken by the filter's bits.
+ * @return The size of the bit array in bytes.
+ * */
+std::size_t BloomFilter::bytes() const{
+    return words.size() * sizeof(std::uint64_t);
+}
+
+/**
+ * Estimated from the fraction of bits set: an unknown string passes only if every one of its
+ * bits happens to be set.
+ * @brief Returns the chance that a string never added passes the filter.
+ * @return The false positive rate, between 0 and 1.
+ * */
+double BloomFilter::falsePositiveRate() const{
+    if(bitCount == 0){
+        return 0;
+    }
+    return std::pow(static_cast<double>(setBits) / bitCount, HASHES);
+}
+
+/**
+ * The bit positions are derived from two hashes (h1 + i * h2), which spreads them as well as
+ * independent hash functions would at the cost of one.
+ * @brief Computes the two hashes of a string.
+ * @param text The string to hash.
+ * @param h1 Receives the first hash.
+ * @param h2 Receives the second hash, which is always odd.
+ * */
+void BloomFilter::hash(std::string_view text, std::uint64_t& h1, std::uint64_t& h2){
+
+    // splitmix64 steps, so that similar ids (e.g. consecutive student numbers) scatter
+    auto mix = [](std::uint64_t x){
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    };
+
+    h1 = mix(std::hash<std::string_view>()(text));
+    h2 = mix(h1) | 1;
+}
@@ -0,0 +1,44 @@
+/**
+ * The header file for the bloom filter.
+ * This stores the declarations of the filter used to reject unknown ids before any index lookup.
+ * @brief The header file for the bloomfilter class.
+ * @author Justin Teichman
+ * */
+
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <sharedvector.h>
+#include <string_view>
+#include <cstdint>
+
+class BloomFilter {
+
+    public:
+        BloomFilter();
+
+        void reset(std::size_t capacity);
+        void add(std::string_view);
+        bool mightContain(std::string_view) const;
+
+        std::size_t count() const;
+        std::size_t capacity() const;
+        std::size_t bytes() const;
+        double falsePositiveRate() const;
+
+    private:
+        // Bits per expected entry, and the number of bits set per entry. Together they keep
+        // the false positive rate near 1% while the filter holds up to its capacity.
+        static const std::size_t BITS_PER_ENTRY = 10;
+        static const int HASHES = 7;
+
+        SharedVector<std::uint64_t> words;  // shared with copies of the filter until changed
+        std::uint64_t bitCount;
+        std::size_t entries;
+        std::size_t limit;
+        std::size_t setBits;
+
+        static void hash(std::string_view, std::uint64_t&, std::uint64_t&);
+};
+
+#endif
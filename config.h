@@ -1 +1,52 @@
 // #define USING_CAMERA
+
+// With USING_CAMERA, decode QR codes with OpenCV's C++ API (NativeCamera.cpp) instead of
+// running qrcode.py in an embedded Python interpreter (Camera.cpp)
+// #define USING_NATIVE_CAMERA
+
+// Print the time every scan took to the console; start-up times are always printed
+// #define SCAN_TIMING
+
+// How many of the latest camera frames are kept for the decoder; older ones are dropped
+#define FRAME_RING_SIZE 4
+
+// Where the camera reads frames from: a camera number ("0" is the default camera), a video
+// file, or a directory of images. Recordings are played at their own frame rate.
+#define CAMERA_SOURCE "0"
+
+// With USING_NATIVE_CAMERA, frames are searched for a code scaled down to QR_DETECT_WIDTH pixels
+// wide (0 searches them at full size), and only the region around a code, widened by
+// QR_REGION_MARGIN of its size on each side, is decoded at full resolution (see QRTracker)
+#define QR_DETECT_WIDTH 480
+#define QR_REGION_MARGIN 0.25
+
+// Decode every code in a frame (true), up to QR_MAX_CODES, so a group holding up their passes
+// together is let through at once, or only one (false). While every code is tracked, the frame
+// is still searched every QR_SEARCH_INTERVAL frames for codes coming into view.
+#define QR_MULTI_CODE true
+#define QR_MAX_CODES 8
+#define QR_SEARCH_INTERVAL 5
+
+// With USING_NATIVE_CAMERA, how many frames are decoded at once, each on a thread of its own
+// (see DecodePool); 0 runs one decode worker per core
+#define DECODE_WORKERS 0
+
+// Express-lane mode: a new scan that admits or lets out its user replaces the feedback on
+// screen straight away instead of waiting for it to finish; one that would be denied waits
+// its turn. Denials still stay up for at least DENIAL_MIN_DWELL seconds, so the person
+// turned away has time to read why.
+// #define EXPRESS_LANE
+#define DENIAL_MIN_DWELL 3
+
+// Queue between the camera and authentication: how many codes it holds, and which codes it
+// keeps when they arrive faster than they are handled (see ScanQueue::Policy)
+#define SCAN_QUEUE_CAPACITY 16
+#define SCAN_QUEUE_POLICY ScanQueue::DropDuplicates
+
+// Repeat suppression: a code seen again within SCAN_REPEAT_WINDOW seconds of its last sighting
+// is not authenticated again (see ScanFilter). At most SCAN_FILTER_CAPACITY codes are remembered.
+#define SCAN_REPEAT_WINDOW 5
+#define SCAN_FILTER_CAPACITY 4096
+
+// How many recently scanned ids have their authentication decision cached (see DecisionCache)
+#define DECISION_CACHE_CAPACITY 1024
@@ -7,10 +7,26 @@
  * @author Justin Teichman
  * */
 #include <database.h>
+#include <namepool.h>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <unordered_set>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 //Singleton variable to check if the instace been created yet.
 Database* Database::_instance = NULL;
 
+//Files holding the database, its binary snapshot, the journal of changes made since they were written, and a journal being compacted into them.
+static const char *DATABASE_FILE = "vaxData.txt";
+static const char *SNAPSHOT_FILE = "vaxData.bin";
+static const char *JOURNAL_FILE = "vaxData.journal";
+static const char *COMPACTING_FILE = "vaxData.journal.compacting";
+
 /**
  * Singleton constructor
  * This is a singleton constructor, meaning that only one instance of the database class can exist at once.
@@ -29,383 +45,490 @@ Database& Database::instance(){
  * Constructor
  * The constructor for the database class is called by the singleton constructor.
  * This can only ever be called once.
- * It opens the file containing the vax database and copies it into a record vector.
+ * It loads the vax database into a record store, from its binary snapshot if that is up to date
+ * with the database file (see loadSnapshot()), otherwise from the database file itself (see loadText()),
+ * in which case a new snapshot is written for the next launch.
+ * Changes journaled since the file was last written are then replayed on top of it.
+ * A journal left sealed by a compaction that never finished is replayed first, since its
+ * entries are older, and the result is written out straight away to finish that compaction.
+ * The loaded store then becomes the first published version of the records (see view()).
  * @brief Creates a record vector from the vax database.
  * */
-Database::Database(){
+Database::Database() : journal(JOURNAL_FILE){
     
-    std::ifstream fin;
-    fin.open("vaxData.txt");
-    std::string line;
-    std::vector<std::string> vect;
-    while(getline(fin,line)){
-             
-        vect = readRecord(line);
-        Record rec(vect[0],vect[1], vect[2], vect[3]);
-        vaxRec.push_back(rec);
+    compacting = false;
+
+    std::shared_ptr<RecordStore> store = std::make_shared<RecordStore>();
+    if(!loadSnapshot(SNAPSHOT_FILE, DATABASE_FILE, *store)){
+        loadText(DATABASE_FILE, *store);
+        Snapshot::write(SNAPSHOT_FILE, store->records(), DATABASE_FILE);
+    }
+    NamePool& pool = NamePool::instance();
+    stats.memoryBytes = stats.records * sizeof(Record) + pool.size() * sizeof(std::string) + pool.bytes();
+    std::cout << "Loaded " << stats.records << " records from " << stats.source << " in " << stats.milliseconds << " ms ("
+              << (stats.records > 0 ? stats.fileBytes / stats.records : 0) << " bytes/record on disk, "
+              << (stats.records > 0 ? stats.memoryBytes / stats.records : 0) << " in memory)" << std::endl;
+    std::cout << "Id filter: " << store->filter().bytes() << " bytes, estimated false positive rate "
+              << store->filter().falsePositiveRate() * 100 << "%" << std::endl;
+
+    bool interrupted = std::ifstream(COMPACTING_FILE).good();
+    if(interrupted){
+        Journal::replay(COMPACTING_FILE, *store);
+    }
+    Journal::replay(JOURNAL_FILE, *store);
+    journal.open();
+    vaxRec = store;
+
+    if(interrupted && writeDatabase(store->records())){
+        remove(COMPACTING_FILE);
     }
 }
 
 /**
- * Is given a record and adds it into the record vector.
- * @brief Adds a user into the record vector.
- * @param rec The record that is being added into the vector.
- * @return true if the user was added and false otherwise.
+ * Loads a binary snapshot into a record store, provided it was made from the current
+ * contents of its source file (see the Snapshot class).
+ * The figures for this load are kept for loadStats().
+ * @brief Loads the records of a binary snapshot.
+ * @param path The path of the snapshot.
+ * @param source The path of the database file the snapshot must match.
+ * @param store The store to load the records into.
+ * @return true if the snapshot was loaded, false if it is missing, stale or damaged.
  * */
-bool Database::addUser(Record rec){
-    
-    if(!checkDict(rec)){
-        vaxRec.push_back(rec);
-        writeToText();
-        return true;
+bool Database::loadSnapshot(const char *path, const char *source, RecordStore& store){
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<Record>> parsed(1);
+    if(!Snapshot::read(path, parsed[0], source)){
+        return false;
     }
-    return false;
+
+    stats = LoadStats();
+    stats.source = path;
+    stats.duplicates = store.load(parsed).size();
+    stats.records = store.size();
+    struct stat info;
+    stats.fileBytes = stat(path, &info) == 0 ? info.st_size : 0;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
 }
 
 /**
- * Is given a record to delete from the record vector and deletes it.
- * @brief Deletes a record from the vector.
- * @param rec The record that will be deleted.
- * @return true if the record was deleted, false otherwise.
+ * Loads a database file into a record store.
+ * The file is memory-mapped and cut into chunks that each end on a line break, one per
+ * processor core (large files only; small ones are parsed as a single chunk). The chunks are
+ * parsed in parallel and then loaded into the store together, which is where duplicate ids
+ * are caught, whichever chunks they fall in.
+ * Ids are unique, so any later line reusing an id that is already loaded is skipped with a warning.
+ * The figures for this load are kept for loadStats().
+ * @brief Loads the records of a database file.
+ * @param path The path of the database file.
+ * @param store The store to load the records into.
  * */
-bool Database::deleteUser(Record rec){
+void Database::loadText(const char *path, RecordStore& store){
+
+    auto start = std::chrono::steady_clock::now();
+    stats = LoadStats();
+    stats.source = path;
+
+    MappedFile file;
+    if(file.open(path)){
+
+        std::string_view text = file.view();
+        std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        workers = std::min(workers, text.size() / MIN_CHUNK_BYTES + 1);
+
+        std::vector<std::string_view> chunks;
+        std::size_t begin = 0;
+        for(std::size_t i = 1; i <= workers && begin < text.size(); i++){
+            std::size_t end = text.size();
+            if(i < workers){
+                end = text.find('\n', std::max(begin, text.size() * i / workers));
+                end = (end == std::string_view::npos) ? text.size() : end + 1;
+            }
+            chunks.push_back(text.substr(begin, end - begin));
+            begin = end;
+        }
 
-    for (std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(recordEquals(rec,vaxRec.at(i))){
-            vaxRec.erase(vaxRec.begin()+i);
-            writeToText();
-            return true;
+        std::vector<std::vector<Record>> parsed(chunks.size());
+        std::vector<std::size_t> malformed(chunks.size(), 0);
+        std::vector<std::thread> pool;
+        for(std::size_t i = 1; i < chunks.size(); i++){
+            pool.emplace_back(parseChunk, chunks[i], std::ref(parsed[i]), std::ref(malformed[i]));
+        }
+        if(!chunks.empty()){
+            parseChunk(chunks[0], parsed[0], malformed[0]);
         }
+        for(std::thread& worker : pool){
+            worker.join();
+        }
+
+        for(std::size_t count : malformed){
+            stats.malformed += count;
+        }
+        for(const Record& dup : store.load(parsed)){
+            stats.duplicates++;
+            std::cerr << path << ": skipping duplicate id " << dup.getId().view() << std::endl;
+        }
+        stats.records = store.size();
+        stats.fileBytes = file.size();
     }
-    return false;
+
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 /**
- * Is given the id of a record to be deleted and deletes the record from the vector matching that id.
- * @brief Deletes the record that matches the id given.
- * @param id The id that corresponds to the record to be deleted.
- * @return true if the record with the id was deleted and false otherwise.
+ * Runs on one of the parsing threads started by loadText().
+ * @brief Parses every line of a chunk of the database file into records.
+ * @param chunk The lines to parse.
+ * @param out Receives the records, in file order.
+ * @param malformed Receives the number of lines skipped because they have fewer than four fields.
  * */
-bool Database::deleteUser(std::string id){
+void Database::parseChunk(std::string_view chunk, std::vector<Record>& out, std::size_t& malformed){
 
-    for (std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getId() == id){
-            vaxRec.erase(vaxRec.begin()+i);
-            writeToText();
-            return true;
+    const char *pos = chunk.data();
+    const char *end = pos + chunk.size();
+    std::string_view field[4];
+
+    while(pos < end){
+        const char *newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        const char *lineEnd = newline != nullptr ? newline : end;
+
+        if(parseLine(std::string_view(pos, lineEnd - pos), field)){
+            out.emplace_back(field[0], field[1], field[2], field[3]);
+        }else{
+            malformed++;
         }
+        pos = lineEnd + 1;
     }
-    return false;
 }
 
 /**
- * Is given an older record and replaces it with an updated version.
- * Searches for the old record and replaces it with the new one when it is found.
- * @brief Replaces an old record with a new record.
- * @param oldRec The old record that will be replaced.
- * @param newRec The new record that will "added" to the vector.
- * @return true if the record was replaced and false otherwise.
+ * Splits a line of the database file on its "," delimiters without copying it.
+ * Any fields after the fourth are ignored.
+ * @brief Splits a line of the vax database into its four fields.
+ * @param line The line of text being processed.
+ * @param field Receives views of the id, first name, last name and date fields.
+ * @return true if the line has all four fields, false otherwise.
  * */
-bool Database::editRecord(Record oldRec, Record newRec){
-    
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(recordEquals(vaxRec.at(i), oldRec)){
-            vaxRec.at(i) = newRec;
-            writeToText();
-            return true;
+bool Database::parseLine(std::string_view line, std::string_view (&field)[4]){
+
+    for(int i = 0; i < 4; i++){
+        std::size_t comma = line.find(',');
+        if(comma == std::string_view::npos){
+            if(i < 3){
+                return false;
+            }
+            field[i] = line;
+        }else{
+            field[i] = line.substr(0, comma);
+            line.remove_prefix(comma + 1);
         }
     }
-    return false;
+    return true;
 }
 
 /**
- * Returns the vector of records.
- * Will return all records.
- * @brief Returns all records in the vector.
- * @return The vetor holding the records.
+ * Trims the whitespace around a field and lowercases it, the way the admin form cleans its input.
+ * @brief Normalizes a field of an imported record.
+ * @param field The field to clean.
+ * @return The cleaned field.
  * */
-std::vector<Record> Database::getAll(){
-    return vaxRec;
-}
+std::string Database::normalize(std::string_view field){
 
-/**
- * Searches for a record with the id given.
- * Returns the record once found.
- * @brief Returns the record that matches the id given.
- * @param id The id of the record to be returned.
- * @return The record that has the id matching the id given. If no record matches the id, return record 0.
- * */
-Record Database::searchById(std::string id){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-       if(vaxRec.at(i).getId() == id){
-           return vaxRec.at(i);
-       } 
+    std::size_t begin = field.find_first_not_of(" \t\r");
+    if(begin == std::string_view::npos){
+        return "";
+    }
+    std::size_t end = field.find_last_not_of(" \t\r");
+
+    std::string clean(field.substr(begin, end - begin + 1));
+    for(char& c : clean){
+        c = std::tolower(static_cast<unsigned char>(c));
     }
-    return vaxRec.at(0);
+    return clean;
 }
 
 /**
- * Searches for if the id given is in found in a record in the vector.
- * If the vector contains a record with the matching id, return true, false otherwise.
- * @brief Returns whether or not a record in the vector has ths given id.
- * @param id The id to be checked for in the vector.
- * @return true if the id is contained in a record in the vector, false otherwise.
+ * @brief Returns the figures recorded when the database file was loaded.
+ * @return The number of records, skipped lines, bytes and milliseconds of the last load.
  * */
-bool Database::findId(std::string id){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-       if(vaxRec.at(i).getId() == id){
-           return true;
-       } 
-    }
-    return false;
+const LoadStats& Database::loadStats() const{
+    return stats;
 }
 
 /**
- * Searches the vector for records that have the first name given.
- * If a record in the vector has the given first name, it is returned.
- * Multiple records can be returned.
- * @brief Returns all records with the first name matching the parameter given.
- * @param first The first name to match records to.
- * @return A vector of records that have the first name matching the parameter given.
+ * Is given a record and adds it into the record vector.
+ * A record whose id is already in use is rejected.
+ * @brief Adds a user into the record vector.
+ * @param rec The record that is being added into the vector.
+ * @return true if the user was added and false otherwise.
  * */
-std::vector<Record> Database::searchByFirst(std::string first){
-    std::vector<Record> query;
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first){
-            query.push_back(vaxRec.at(i));
-        }
+bool Database::addUser(Record rec){
+    
+    std::lock_guard<std::mutex> guard(writeLock);
+    if(view()->find(rec.getId()) != nullptr){
+        return false;
     }
-    return query;
+    std::shared_ptr<RecordStore> next = draft();
+    next->insert(rec);
+    journal.logPut(rec);
+    publish(next, {std::string(rec.getId())});
+    persist();
+    return true;
 }
 
 /**
- * Searches for if the first name given is in found in a record in the vector.
- * If the vector contains a record with the matching first name, return true, false otherwise.
- * @brief Returns whether or not a record in the vector has ths given first name.
- * @param first The first name to be checked for in the vector.
- * @return true if the first name is contained in a record in the vector, false otherwise.
+ * Is given a record to delete from the record vector and deletes it.
+ * @brief Deletes a record from the vector.
+ * @param rec The record that will be deleted.
+ * @return true if the record was deleted, false otherwise.
  * */
-bool Database::findFirst(std::string first){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first){
-            return true;
-        }
+bool Database::deleteUser(Record rec){
+
+    if(checkDict(rec)){
+        return deleteUser(std::string(rec.getId()));
     }
     return false;
 }
 
 /**
- * Searches the vector for records that have the last name given.
- * If a record in the vector has the given last name, it is returned.
- * Multiple records can be returned.
- * @brief Returns all records with the last name matching the parameter given.
- * @param last The last name to match records to.
- * @return A vector of records that have the last name matching the parameter given.
+ * Is given the id of a record to be deleted and deletes the record from the vector matching that id.
+ * @brief Deletes the record that matches the id given.
+ * @param id The id that corresponds to the record to be deleted.
+ * @return true if the record with the id was deleted and false otherwise.
  * */
-std::vector<Record> Database::searchByLast(std::string last){
-    std::vector<Record> query;
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getlName() == last){
-            query.push_back(vaxRec.at(i));
-        }
+bool Database::deleteUser(std::string id){
+
+    std::lock_guard<std::mutex> guard(writeLock);
+    if(view()->find(id) == nullptr){
+        return false;
     }
-    return query;
+    std::shared_ptr<RecordStore> next = draft();
+    next->remove(id);
+    journal.logRemove(id);
+    publish(next, {id});
+    persist();
+    return true;
 }
 
 /**
- * Searches for if the last name given is in found in a record in the vector.
- * If the vector contains a record with the matching last name, return true, false otherwise.
- * @brief Returns whether or not a record in the vector has ths given last name.
- * @param last The last name to be checked for in the vector.
- * @return true if the last name is contained in a record in the vector, false otherwise.
+ * Is given an older record and replaces it with an updated version.
+ * Searches for the old record and replaces it with the new one when it is found.
+ * The edit is refused if it would give the record an id that another record already uses.
+ * @brief Replaces an old record with a new record.
+ * @param oldRec The old record that will be replaced.
+ * @param newRec The new record that will "added" to the vector.
+ * @return true if the record was replaced and false otherwise.
  * */
-bool Database::findlast(std::string last){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getlName() == last){
-            return true;
-        }
+bool Database::editRecord(Record oldRec, Record newRec){
+    
+    std::lock_guard<std::mutex> guard(writeLock);
+    if(!checkDict(oldRec)){
+        return false;
     }
-    return false;
+    std::shared_ptr<RecordStore> next = draft();
+    if(!next->replace(oldRec.getId(), newRec)){
+        return false;
+    }
+    journal.logReplace(std::string(oldRec.getId()), newRec);
+    publish(next, {std::string(oldRec.getId()), std::string(newRec.getId())});
+    persist();
+    return true;
 }
 
 /**
- * Searches the vector for records that have a date field matching the date given.
- * If a record has the matching date field, it will be returned.
- * Multiple records can therefore be returned.
- * @brief Returns all records that match to the date given.
- * @param date The date that records are being compared against.
- * @return A vector containing all records with a date field the same as the date given.
+ * Adds many records at once. Each record is handled as addUser() would, but the indexes are
+ * sized for the whole batch up front, the journal entries are flushed together, and the
+ * database is persisted once at the end instead of after every record.
+ * @brief Adds a batch of users into the record vector.
+ * @param recs The records to add.
+ * @return How many records were added, and how many were skipped because their id is already in use.
  * */
-std::vector<Record> Database::searchByDate(std::string date){
-    std::vector<Record> query;
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getDate() == date){
-            query.push_back(vaxRec.at(i));
+BatchResult Database::addUsers(const std::vector<Record>& recs){
+
+    std::lock_guard<std::mutex> guard(writeLock);
+    BatchResult result = BatchResult();
+    std::vector<std::string> changed;
+    std::shared_ptr<RecordStore> next = draft();
+    next->reserve(recs.size());
+    journal.beginBatch();
+    for(const Record& rec : recs){
+        if(next->insert(rec)){
+            journal.logPut(rec);
+            changed.emplace_back(rec.getId());
+            result.added++;
+        }else{
+            result.skipped++;
         }
     }
-    return query;
+    journal.endBatch();
+    publish(next, changed);
+    persist();
+    return result;
 }
 
 /**
- * Searches the vector for a record that has the date given.
- * If a record is found that has this date, return true, false otherwise.
- * @brief Returns true or false based on if the date given is found inside a record.
- * @param date The date that records are being compared against.
- * @return true if a record is found with the same date, false otherwise.
+ * Deletes many records at once, journaling and persisting them together (see addUsers()).
+ * @brief Deletes a batch of records by id.
+ * @param ids The ids of the records to delete.
+ * @return How many records were removed, and how many ids matched no record.
  * */
-bool Database::findDate(std::string date){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getDate() == date){
-            return true;
+BatchResult Database::deleteUsers(const std::vector<std::string>& ids){
+
+    std::lock_guard<std::mutex> guard(writeLock);
+    BatchResult result = BatchResult();
+    std::vector<std::string> changed;
+    std::shared_ptr<RecordStore> next = draft();
+    journal.beginBatch();
+    for(const std::string& id : ids){
+        if(next->remove(id)){
+            journal.logRemove(id);
+            changed.push_back(id);
+            result.removed++;
+        }else{
+            result.skipped++;
         }
     }
-    return false;
+    journal.endBatch();
+    publish(next, changed);
+    persist();
+    return result;
 }
 
 /**
- * Searches the vector for records that have first and last name fields matching the first and last names given.
- * If a record has the matching fields, it will be returned.
- * Multiple records can therefore be returned.
- * @brief Returns all records that match to the first and last names given.
- * @param first The first name that records are being compared against.
- * @param last The last name that records are being compared against.
- * @return A vector containing all records with first and last name fields that are the same as the fields given.
+ * Imports a roster of records from a stream of "id,first,last,date" lines, such as a new
+ * term's list of students, in a single pass.
+ * Fields are trimmed and lowercased as the admin form does, and a line is only accepted
+ * with all four fields filled in and a valid YYYY.MM.DD date. A new id is added, and a known
+ * id has its record overwritten if it differs; an id repeated later in the stream is skipped,
+ * so the first line for each id wins, as when loading the database file.
+ * The changes are journaled and persisted together (see addUsers()).
+ * @brief Adds or updates every record listed in a stream.
+ * @param in The stream to read the records from.
+ * @param progress Called every PROGRESS_INTERVAL lines and once at the end with the bytes read
+ *                 so far and the size of the stream (0 if it is unknown). May be empty.
+ * @return How many records were added, updated or skipped, and how many lines were invalid.
  * */
-std::vector<Record> Database::searchByFirstLast(std::string first, std::string last){
-    std::vector<Record> query;
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first && vaxRec.at(i).getlName() == last){
-            query.push_back(vaxRec.at(i));
-        }
+BatchResult Database::upsertText(std::istream& in, const std::function<void(std::size_t, std::size_t)>& progress){
+
+    std::lock_guard<std::mutex> guard(writeLock);
+    BatchResult result = BatchResult();
+    std::vector<std::string> changed;
+    std::shared_ptr<RecordStore> next = draft();
+
+    std::size_t total = 0;
+    std::streampos begin = in.tellg();
+    if(begin != std::streampos(-1) && in.seekg(0, std::ios::end)){
+        total = static_cast<std::size_t>(in.tellg() - begin);
+        in.seekg(begin);
     }
-    return query;
-}
+    in.clear();
 
-/**
- * Searches the vector for a record that has the first and last names given.
- * If a record is found that has these first and last names, return true, false otherwise.
- * @brief Returns true or false based on if the first and last names given are found inside a record.
- * @param first The firstname that records are being compared against.
- * @param last The lastname that records are being compared against.
- * @return true if a record is found with the same first and last names, false otherwise.
- * */
-bool Database::findFirstLast(std::string first, std::string last){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first && vaxRec.at(i).getlName() == last){
-            return true;
+    std::unordered_set<std::uint64_t> seen;
+    std::string line;
+    std::size_t read = 0, lines = 0;
+    std::string_view field[4];
+
+    journal.beginBatch();
+    while(getline(in, line)){
+
+        read += line.size() + 1;
+        if(progress && ++lines % PROGRESS_INTERVAL == 0){
+            progress(std::min(read, total), total);
         }
-    }
-    return false;
-}
 
-/**
- * Searches the vector for records that have firstname and date fields matching the arguments given.
- * If a record has the matching fields, it will be returned.
- * Multiple records can therefore be returned.
- * @brief Returns all records that match to the firstname and date attributes given.
- * @param first The firstname that records are being compared against.
- * @param date The date that records ar being compared against.
- * @return A vector containing all records with firstname and date fields that are the same as the fields given.
- * */
-std::vector<Record> Database::searchByFirstDate(std::string first, std::string date){
-    std::vector<Record> query;
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first && vaxRec.at(i).getDate() == date){
-            query.push_back(vaxRec.at(i));
+        std::int32_t day;
+        if(!parseLine(line, field)){
+            result.invalid++;
+            continue;
+        }
+        std::string id = normalize(field[0]), first = normalize(field[1]);
+        std::string last = normalize(field[2]), date = normalize(field[3]);
+        if(id.empty() || first.empty() || last.empty() || !Record::parseDay(date, day)){
+            result.invalid++;
+            continue;
         }
-    }
-    return query;
-}
 
-/**
- * Searches the vector for a record that has the firstname and date given.
- * If a record is found that has these firstname and date fields, return true, false otherwise.
- * @brief Returns true or false based on if the firstname and date fields given are found inside a record.
- * @param date The date that records are being compared against.
- * @param first The firstname that records are being compared against.
- * @return true if a record is found with the same firstname and date, false otherwise.
- * */
-bool Database::findFirstDate(std::string first, std::string date){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first && vaxRec.at(i).getDate() == date){
-            return true;
+        Record rec(id, first, last, date);
+        if(!seen.insert(rec.getKey()).second){
+            result.skipped++;
+            continue;
+        }
+
+        const Record *old = next->find(id);
+        if(old == nullptr){
+            next->insert(rec);
+            result.added++;
+        }else if(*old != rec){
+            next->replace(id, rec);
+            result.updated++;
+        }else{
+            result.skipped++;
+            continue;
         }
+        journal.logPut(rec);
+        changed.push_back(id);
     }
-    return false;
+    journal.endBatch();
+    publish(next, changed);
+    persist();
+
+    if(progress){
+        progress(total > 0 ? total : read, total);
+    }
+    return result;
 }
 
 /**
- * Searches the vector for records that have lastname and date fields matching the arguments given.
- * If a record has the matching fields, it will be returned.
- * Multiple records can therefore be returned.
- * @brief Returns all records that match to the lastname and date attributes given.
- * @param last The lastname that records are being compared against.
- * @param date The date that records ar being compared against.
- * @return A vector containing all records with lastname and date fields that are the same as the fields given.
+ * Returns the vector of records.
+ * Will return all records.
+ * @brief Returns all records in the vector.
+ * @return The vetor holding the records.
  * */
-std::vector<Record> Database::searchByLastDate(std::string last, std::string date){
-   std::vector<Record> query;
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getlName() == last && vaxRec.at(i).getDate() == date){
-            query.push_back(vaxRec.at(i));
-        }
-    }
-    return query;
+std::vector<Record> Database::getAll(){
+    return view()->records();
 }
 
 /**
- * Searches the vector for a record that has the lastname and date given.
- * If a record is found that has these lastname and date fields, return true, false otherwise.
- * @brief Returns true or false based on if the lastname and date fields given are found inside a record.
- * @param date The date that records are being compared against.
- * @param last The lastname that records are being compared against.
- * @return true if a record is found with the same lastname and date, false otherwise.
+ * Searches for a record with the id given.
+ * Returns the record once found.
+ * @brief Returns the record that matches the id given.
+ * @param id The id of the record to be returned.
+ * @return The record that has the id matching the id given. If no record matches the id, return record 0.
  * */
-bool Database::findLastDate(std::string last, std::string date){
-     for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getlName() == last && vaxRec.at(i).getDate() == date){
-            return true;
-        }
+Record Database::searchById(std::string id){
+    std::shared_ptr<const RecordStore> current = view();
+    const Record *rec = current->find(id);
+    if(rec != nullptr){
+        return *rec;
     }
-    return false;
+    return current->at(0);
 }
 
 /**
- * Searches the vector for records that have firstname, lastname, and date fields matching the arguments given.
- * If a record has the matching fields, it will be returned.
- * Multiple records can therefore be returned.
- * @brief Returns all records that match to the firstname, lastname, and date attributes given.
- * @param first The firstname that records are being compared against.
- * @param last The lastname that records are being compared against.
- * @param date The date that records ar being compared against.
- * @return A vector containing all records with firstname, lastname, and date fields that are the same as the fields given.
+ * Searches for if the id given is in found in a record in the vector.
+ * If the vector contains a record with the matching id, return true, false otherwise.
+ * @brief Returns whether or not a record in the vector has ths given id.
+ * @param id The id to be checked for in the vector.
+ * @return true if the id is contained in a record in the vector, false otherwise.
  * */
-std::vector<Record> Database::searchByFirstLastDate(std::string first, std::string last, std::string date){
-    std::vector<Record> query;
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first && vaxRec.at(i).getlName() == last && vaxRec.at(i).getDate() == date){
-            query.push_back(vaxRec.at(i));
-        }
-    }
-    return query;
+bool Database::findId(std::string id){
+    return view()->find(id) != nullptr;
 }
 
 /**
- * Searches the vector for a record that has the firstname, lastname, and date given.
- * If a record is found that has these firstname, lastname, and date fields, return true, false otherwise.
- * @brief Returns true or false based on if the firstname, lastname, and date fields given are found inside a record.
- * @param date The date that records are being compared against.
- * @param first The firstname that records are being compared against.
- * @param last The lastname that records are being compared against.
- * @return true if a record is found with the same firstname, lastname and date, false otherwise.
+ * Searches the records for every record matching the fields given.
+ * Any field left empty matches every record, so any combination of fields can be searched.
+ * The query is answered from the store's per-field indexes rather than a scan of every record.
+ * @brief Returns all records that match every non-empty field given.
+ * @param id The id that records are being compared against, or "".
+ * @param first The firstname that records are being compared against, or "".
+ * @param last The lastname that records are being compared against, or "".
+ * @param date The date that records are being compared against, or "".
+ * @return A vector containing all records matching the fields given.
  * */
-bool Database::findFirstLastDate(std::string first, std::string last, std::string date){
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(vaxRec.at(i).getfName() == first && vaxRec.at(i).getlName() == last && vaxRec.at(i).getDate() == date){
-            return true;
-        }
-    }
-    return false;
+std::vector<Record> Database::query(std::string id, std::string first, std::string last, std::string date){
+    return view()->query(id, first, last, date);
 }
 
 /**
@@ -444,26 +567,23 @@ std::vector<std::string> Database::readRecord(std::string line){
 */
 bool Database::recordEquals(Record vaxRec, Record inputRec){
 
-    if(vaxRec.getId() == inputRec.getId() && vaxRec.getfName() == inputRec.getfName() && vaxRec.getlName() == inputRec.getlName() && vaxRec.getDate() == inputRec.getDate()){
-        return true;
-    }else{
-        return false;
-    }
+    return vaxRec == inputRec;
 
 }
 
 /**
  * Checks if a certain record is in the dictionary.
  * This function return true if the record is in the dictionary and false if it is not.
+ * Since ids are unique, only the record indexed under rec's id has to be compared.
  * @brief Check the vector for this exact record.
  * @param rec The record that the vector is being checked for.
  * @return true if a matching record is found, false otherwise.
 */
 bool Database::checkDict(Record rec){
-    for (std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        if(recordEquals(rec,vaxRec.at(i))){
-            return true;
-        }
+    std::shared_ptr<const RecordStore> current = view();
+    const Record *found = current->find(rec.getId());
+    if(found != nullptr){
+        return recordEquals(rec, *found);
     }
     return false;
 
@@ -472,20 +592,165 @@ bool Database::checkDict(Record rec){
 /**
  * The vector that the system uses is a copy of the database file.
  * If a change is made to the database, it is made to the vector instead.
- * To save changes to the database, the database needs to be overwritten with the updated vector.
- * This method will write the vector to the database of records.
- * @brief Write the record vector the records.txt, overriding the data stored in the file in the process.
+ * Changes are normally saved by appending them to the journal (see persist()).
+ * This method instead writes the whole vector to the database of records at once.
+ * @brief Write the record vector to the database file, overriding the data stored in the file in the process.
  * */
 void Database::writeToText(){
+    writeDatabase(view()->records());
+}
+
+/**
+ * Returns the current version of the records.
+ * Versions are never modified once published: a change is made to a copy, which then
+ * replaces the current version in a single atomic step (see publish()). A caller holding a
+ * view therefore reads a consistent set of records without taking any lock, however long
+ * it keeps the view and whatever changes are made meanwhile; it only has to call view()
+ * again to see them.
+ * @brief Returns an immutable view of the records.
+ * @return The current version of the record store.
+ * */
+std::shared_ptr<const RecordStore> Database::view() const{
+    return std::atomic_load(&vaxRec);
+}
+
+/**
+ * Called with writeLock held, before making a change.
+ * The copy shares the records and indexes of the current version, and only copies the few
+ * pieces the change then writes to (see SharedVector), so it costs about the same however
+ * many records the database holds.
+ * @brief Copies the current version of the records, to be changed and then published.
+ * @return A private copy of the current record store.
+ * */
+std::shared_ptr<RecordStore> Database::draft(){
+    return std::make_shared<RecordStore>(*view());
+}
+
+/**
+ * Called with writeLock held, once a change has been made to a draft and journaled.
+ * Readers that took a view earlier keep the version they have; it is freed when the last of them lets go.
+ * The change listeners are told about the change once the new version is current, so
+ * anything they look up from then on sees it.
+ * @brief Makes a changed copy of the records the current version.
+ * @param next The changed copy.
+ * @param changed The ids of the records that were added, changed or removed.
+ * */
+void Database::publish(std::shared_ptr<RecordStore> next, const std::vector<std::string>& changed){
+    std::atomic_store(&vaxRec, std::shared_ptr<const RecordStore>(std::move(next)));
+    if(changed.empty()){
+        return;
+    }
+    for(const ChangeListener& listener : listeners){
+        listener(changed);
+    }
+}
+
+/**
+ * Registers a function to be told about every change to the records, e.g. to drop anything
+ * it has cached about them. Listeners are called on the thread making the change, with
+ * writeLock held, so they must be quick and must not change the database themselves.
+ * @brief Adds a change listener.
+ * @param listener The function to call with the ids of the records each change touched.
+ * */
+void Database::addChangeListener(ChangeListener listener){
+    std::lock_guard<std::mutex> guard(writeLock);
+    listeners.push_back(std::move(listener));
+}
+
+/**
+ * Called with writeLock held, after every change has been appended to the journal.
+ * Once the journal grows past COMPACT_THRESHOLD entries it is compacted into the database file.
+ * @brief Saves a change and compacts the journal when it grows too long.
+ * */
+void Database::persist(){
+    if(journal.entries() >= COMPACT_THRESHOLD){
+        startCompaction();
+    }
+}
+
+/**
+ * Folds the journal back into the database file without blocking the caller.
+ * The current journal is sealed under a separate name and a fresh journal takes over, then a
+ * background thread writes the current records out as the new database file and deletes the
+ * sealed journal. The old database file is only replaced once the new one is completely on disk,
+ * so stopping at any point leaves either the old file plus the sealed journal or the new file,
+ * both of which load back to the same records.
+ * If a previous compaction failed, its sealed journal is kept and the write is simply retried.
+ * @brief Compacts the journal into the database file in the background.
+ * */
+void Database::compact(){
+    std::lock_guard<std::mutex> guard(writeLock);
+    startCompaction();
+}
+
+/**
+ * Called with writeLock held, so no change can slip in between sealing the journal and
+ * taking the version of the records it covers.
+ * @brief Seals the journal and starts the compaction thread (see compact()).
+ * */
+void Database::startCompaction(){
+
+    if(compacting){
+        return;
+    }
+    if(compactor.joinable()){
+        compactor.join();
+    }
+
+    bool retry = std::ifstream(COMPACTING_FILE).good();
+    if(!retry && !journal.seal(COMPACTING_FILE)){
+        return;
+    }
+
+    compacting = true;
+    compactor = std::thread(&Database::finishCompaction, this, view());
+}
+
+/**
+ * Runs on the compaction thread started by compact().
+ * @brief Writes a snapshot of the records and discards the sealed journal it covers.
+ * @param snapshot The version of the records current when the journal was sealed.
+ * */
+void Database::finishCompaction(std::shared_ptr<const RecordStore> snapshot){
+    if(writeDatabase(snapshot->records())){
+        remove(COMPACTING_FILE);
+    }
+    compacting = false;
+}
+
+/**
+ * Writes the records as the new database file, then refreshes the binary snapshot to match it.
+ * A failure to write the snapshot is not an error: the next launch will parse the database file instead.
+ * @brief Writes a vector of records as the new database file and snapshot.
+ * @param recs The records to write.
+ * @return true if the database file was replaced, false otherwise.
+ * */
+bool Database::writeDatabase(const std::vector<Record>& recs){
+    if(!writeText(recs, DATABASE_FILE)){
+        return false;
+    }
+    Snapshot::write(SNAPSHOT_FILE, recs, DATABASE_FILE);
+    return true;
+}
+
+/**
+ * Writes the records to a temporary file, flushes it to disk and then renames it over the given file.
+ * Renaming replaces the old file in a single step, so the file is never missing or half written.
+ * @brief Writes a vector of records as a comma separated text file.
+ * @param recs The records to write.
+ * @param path The path of the file to write.
+ * @return true if the file was replaced, false otherwise.
+ * */
+bool Database::writeText(const std::vector<Record>& recs, const char *path){
     std::ofstream oin;
     std::string temp;
-    oin.open("records.txt");
+    std::string tempPath = std::string(path) + ".tmp";
+    oin.open(tempPath);
 
-
-    for(std::vector<int>::size_type i = 0; i < vaxRec.size(); i++){
-        temp = vaxRec.at(i).getId() + "," + vaxRec.at(i).getfName() 
-        + "," + vaxRec.at(i).getlName() + "," + vaxRec.at(i).getDate();
-        if(i == vaxRec.size()-1){
+    for(std::vector<int>::size_type i = 0; i < recs.size(); i++){
+        temp = std::string(recs.at(i).getId()) + "," + recs.at(i).getfName() 
+        + "," + recs.at(i).getlName() + "," + std::string(recs.at(i).getDate());
+        if(i == recs.size()-1){
             oin << temp;
         }else{
             oin << temp << std::endl;
@@ -494,8 +759,61 @@ void Database::writeToText(){
     }
 
     oin.close();
-    remove("vaxData.txt"); // remove copy of old database
-    rename("records.txt","vaxData.txt");   // rename new temporary database as database
+    if(oin.fail()){
+        return false;
+    }
+
+    // make sure the new file is on disk before it replaces the old one
+    int fd = ::open(tempPath.c_str(), O_RDONLY);
+    if(fd >= 0){
+        fsync(fd);
+        ::close(fd);
+    }
+    return rename(tempPath.c_str(), path) == 0;   // rename new temporary file as the file
+}
+
+/**
+ * Converts a comma separated database file into a binary snapshot of it.
+ * Lines that are malformed or repeat an earlier id are left out, as when the database is loaded.
+ * @brief Writes a binary snapshot of a text database file.
+ * @param textPath The text file to convert.
+ * @param snapshotPath The snapshot file to write.
+ * @return true if the snapshot was written, false otherwise.
+ * */
+bool Database::importText(const char *textPath, const char *snapshotPath){
+
+    MappedFile file;
+    if(!file.open(textPath)){
+        return false;
+    }
+
+    std::vector<std::vector<Record>> parsed(1);
+    std::size_t malformed = 0;
+    parseChunk(file.view(), parsed[0], malformed);
+
+    RecordStore store;
+    std::size_t duplicates = store.load(parsed).size();
+    std::cout << textPath << ": " << store.size() << " records, " << malformed << " malformed lines, "
+              << duplicates << " duplicate ids" << std::endl;
+    return Snapshot::write(snapshotPath, store.records(), textPath);
+}
+
+/**
+ * Converts a binary snapshot back into a comma separated database file.
+ * The snapshot is read whatever text file it was made from.
+ * @brief Writes the records of a binary snapshot as a text database file.
+ * @param snapshotPath The snapshot file to convert.
+ * @param textPath The text file to write.
+ * @return true if the text file was written, false otherwise.
+ * */
+bool Database::exportText(const char *snapshotPath, const char *textPath){
+
+    std::vector<Record> recs;
+    if(!Snapshot::read(snapshotPath, recs, "")){
+        return false;
+    }
+    std::cout << snapshotPath << ": " << recs.size() << " records" << std::endl;
+    return writeText(recs, textPath);
 }
 
 
@@ -505,5 +823,7 @@ void Database::writeToText(){
  * @brief Destroy the database object.
  * */
 Database::~Database(){
-
+    if(compactor.joinable()){
+        compactor.join();
+    }
 }
@@ -9,15 +9,47 @@
 #define DATABASE_H
 
 #include <record.h>
+#include <recordstore.h>
+#include <journal.h>
+#include <mappedfile.h>
+#include <snapshot.h>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <functional>
 
+// Figures describing the last load of the database file, used to track startup time
+struct LoadStats {
+    const char *source;      // file the records were loaded from
+    std::size_t records;     // records loaded
+    std::size_t duplicates;  // lines skipped because their id was already loaded
+    std::size_t malformed;   // lines skipped because they have fewer than four fields
+    std::size_t fileBytes;   // size of that file
+    std::size_t memoryBytes; // memory held by the records and the names they share, not counting the indexes
+    double milliseconds;     // time taken to load it
+};
+
+// Outcome of a batch operation (see addUsers(), deleteUsers() and upsertText())
+struct BatchResult {
+    std::size_t added;       // records inserted
+    std::size_t updated;     // existing records overwritten by a newer version
+    std::size_t removed;     // records deleted
+    std::size_t skipped;     // valid entries left alone: id already in use or not found, repeated, or unchanged
+    std::size_t invalid;     // lines that are not a valid record
+};
 
 class Database {
 
     public:
+        // Called after every change with the ids of the records it added, changed or removed
+        typedef std::function<void(const std::vector<std::string>&)> ChangeListener;
+
         static Database& instance();
         ~Database();
         bool addUser(Record);
@@ -25,42 +57,61 @@ class Database {
         bool deleteUser(std::string);
         Record getUser(std::string);
         bool editRecord(Record,Record);
+        BatchResult addUsers(const std::vector<Record>&);
+        BatchResult deleteUsers(const std::vector<std::string>&);
+        BatchResult upsertText(std::istream&, const std::function<void(std::size_t, std::size_t)>& progress = nullptr);
         std::vector<std::string> readRecord(std::string);
         bool recordEquals(Record, Record);
         bool checkDict(Record rec);
         void writeToText();
+        void compact();
+        const LoadStats& loadStats() const;
+        std::shared_ptr<const RecordStore> view() const;
+        void addChangeListener(ChangeListener);
+
+        static bool importText(const char *textPath, const char *snapshotPath);
+        static bool exportText(const char *snapshotPath, const char *textPath);
         std::vector<Record> getAll();
         
         Record searchById(std::string);
         bool findId(std::string);
-        
-        std::vector<Record> searchByFirst(std::string);
-        bool findFirst(std::string);
-        
-        std::vector<Record> searchByLast(std::string);
-        bool findlast(std::string);
-        
-        std::vector<Record> searchByDate(std::string);
-        bool findDate(std::string);
-        
-        std::vector<Record> searchByFirstLast(std::string, std::string);
-        bool findFirstLast(std::string, std::string);
-        
-        std::vector<Record> searchByFirstDate(std::string, std::string);
-        bool findFirstDate(std::string, std::string);
-        
-        std::vector<Record> searchByLastDate(std::string, std::string);
-        bool findLastDate(std::string, std::string);
-        
-        std::vector<Record> searchByFirstLastDate(std::string, std::string, std::string);
-        bool findFirstLastDate(std::string, std::string, std::string);
+
+        std::vector<Record> query(std::string, std::string, std::string, std::string);
     
     protected:
         Database();
     
     private:
-        std::vector<Record> vaxRec;
+        std::shared_ptr<const RecordStore> vaxRec;  // the current version; only read or replaced through view() and publish()
+        std::mutex writeLock;                       // held by every change, so changes are applied one at a time
+        Journal journal;
+        std::thread compactor;
+        std::atomic<bool> compacting;
+        LoadStats stats;
+        std::vector<ChangeListener> listeners;      // guarded by writeLock
         static Database* _instance;
+
+        // Number of journal entries after which the journal is folded into the database file
+        static const std::size_t COMPACT_THRESHOLD = 1000;
+
+        // Number of lines imported between two progress reports
+        static const std::size_t PROGRESS_INTERVAL = 1024;
+
+        // Smallest piece of the database file worth handing to its own parsing thread
+        static const std::size_t MIN_CHUNK_BYTES = 1 << 20;
+
+        bool loadSnapshot(const char *path, const char *source, RecordStore& store);
+        void loadText(const char *path, RecordStore& store);
+        static void parseChunk(std::string_view chunk, std::vector<Record>& out, std::size_t& malformed);
+        static bool parseLine(std::string_view line, std::string_view (&field)[4]);
+        static std::string normalize(std::string_view field);
+        std::shared_ptr<RecordStore> draft();
+        void publish(std::shared_ptr<RecordStore> next, const std::vector<std::string>& changed);
+        void persist();
+        void startCompaction();
+        void finishCompaction(std::shared_ptr<const RecordStore> snapshot);
+        static bool writeDatabase(const std::vector<Record>& recs);
+        static bool writeText(const std::vector<Record>& recs, const char *path);
         
 };
 
@@ -0,0 +1,164 @@
+/**
+ * DecisionCache class. The same students pass the same door many times a day, and
+ * each scan would otherwise look their id up in the database and check the date of
+ * their vaccination again. The cache keeps the outcome for the ids scanned most
+ * recently, along with the record whose names are shown on screen, and drops the
+ * least recently used one when it is full.
+ * A decision only stays true for so long: a student vaccinated too recently becomes
+ * eligible at the exact second given by Record::getEligibleAt(), so that is when
+ * their entry expires. Eligible students stay eligible until the database changes,
+ * which the cache hears about through a Database::ChangeListener (see invalidate()).
+ * Unknown ids are not cached: the database's id filter already turns them away
+ * cheaply, and a stream of strangers would otherwise push the regulars out.
+ * Only one thread may call lookup(); invalidate() may be called from any thread.
+ * @brief A least-recently-used cache of authentication decisions.
+ * @author Austin Hatherell
+ */
+
+#include "decisioncache.h"
+#include "database.h"
+
+#include <chrono>
+#include <limits>
+
+/**
+ * Constructor
+ * @brief Creates an empty cache.
+ * @param capacity    The most ids the cache remembers at once.
+ */
+DecisionCache::DecisionCache(std::size_t capacity){
+	this->capacity = capacity > 0 ? capacity : 1;
+	index.reserve(this->capacity);
+	hasPending = false;
+	counters = DecisionCacheStats();
+}
+
+/**
+ * Answers from the cache when it holds an unexpired decision for the id, and
+ * otherwise looks the id up in the current version of the database and caches
+ * the result.
+ * @brief Get the decision for an id.
+ * @param id      The id to look up, i.e. the data of a scanned QR code.
+ * @param now     The current time, in seconds since the epoch.
+ * @param user    Receives the id's record, unless the decision is Unknown.
+ * @return Whether the id is unknown, eligible, or not eligible yet.
+ */
+DecisionCache::Decision DecisionCache::lookup(const std::string &id, std::int64_t now, Record &user){
+	auto start = std::chrono::steady_clock::now();
+	counters.lookups++;
+
+	if(hasPending.load(std::memory_order_acquire))
+		applyInvalidations();
+
+	auto it = index.find(id);
+	if(it != index.end()){
+		if(now < it->second->expiresAt){
+			entries.splice(entries.begin(), entries, it->second);
+			Entry &entry = entries.front();
+			user = entry.user;
+			counters.hits++;
+			counters.hitNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			return entry.decision;
+		}
+		erase(it);
+		counters.expired++;
+	}
+
+	counters.misses++;
+	std::shared_ptr<const RecordStore> records = Database::instance().view();
+	const Record *found = records->find(id);
+	if(found == nullptr){
+		counters.missNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		return Unknown;
+	}
+
+	Entry entry;
+	entry.id = id;
+	entry.user = *found;
+	if(found->isEligible(now)){
+		entry.decision = Eligible;
+		entry.expiresAt = std::numeric_limits<std::int64_t>::max();
+	}else{
+		entry.decision = TooSoon;
+		entry.expiresAt = found->getEligibleAt();
+	}
+	user = entry.user;
+
+	if(entries.size() >= capacity){
+		erase(index.find(entries.back().id));
+		counters.evicted++;
+	}
+	entries.push_front(std::move(entry));
+	index.emplace(entries.front().id, entries.begin());
+
+	counters.missNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	return entries.front().decision;
+}
+
+/**
+ * Meant to be registered with Database::addChangeListener(). The ids are only
+ * noted here, and dropped from the cache at the start of the next lookup(), so
+ * the database may call this from whichever thread changes it.
+ * @brief Forget the decisions for records the database has changed.
+ * @param ids    The ids of the records that were added, changed or removed.
+ */
+void DecisionCache::invalidate(const std::vector<std::string> &ids){
+	std::lock_guard<std::mutex> guard(pendingLock);
+	pending.insert(pending.end(), ids.begin(), ids.end());
+	hasPending.store(true, std::memory_order_release);
+}
+
+/**
+ * Must be called from the thread that calls lookup().
+ * @brief Forget every decision and reset the counters, e.g. at the start of a session.
+ */
+void DecisionCache::clear(){
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		pending.clear();
+		hasPending = false;
+	}
+	index.clear();
+	entries.clear();
+	counters = DecisionCacheStats();
+}
+
+/**
+ * Must be called from the thread that calls lookup().
+ * @brief Get the cache's hit rate and latency counters.
+ * @return The current counters.
+ */
+DecisionCacheStats DecisionCache::stats() const{
+	DecisionCacheStats result = counters;
+	result.size = entries.size();
+	return result;
+}
+
+/**
+ * @brief Drop the entries of every id noted by invalidate().
+ */
+void DecisionCache::applyInvalidations(){
+	std::vector<std::string> ids;
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		ids.swap(pending);
+		hasPending.store(false, std::memory_order_relaxed);
+	}
+	for(const std::string &id : ids){
+		auto it = index.find(id);
+		if(it != index.end()){
+			erase(it);
+			counters.invalidated++;
+		}
+	}
+}
+
+/**
+ * @brief Remove an entry from the cache.
+ * @param it    The entry's position in the index.
+ */
+void DecisionCache::erase(std::unordered_map<std::string_view, std::list<Entry>::iterator>::iterator it){
+	std::list<Entry>::iterator entry = it->second;
+	index.erase(it); // before the entry, whose id the key points into
+	entries.erase(entry);
+}
@@ -0,0 +1,75 @@
+/**
+ * Header for the DecisionCache class, which remembers the authentication decisions
+ * made for recently scanned ids.
+ * @brief The header file for the decisioncache class.
+ * @author Austin Hatherell
+ */
+
+#ifndef DECISIONCACHE_H
+#define DECISIONCACHE_H
+
+#include <list>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+#include "record.h"
+
+// Counters describing a DecisionCache, see DecisionCache::stats()
+struct DecisionCacheStats {
+	std::size_t lookups;     // calls to lookup()
+	std::size_t hits;        // lookups answered from the cache
+	std::size_t misses;      // lookups that went to the database, expired entries included
+	std::size_t expired;     // entries dropped because their record became eligible
+	std::size_t invalidated; // entries dropped because the database changed their record
+	std::size_t evicted;     // least recently used entries dropped to make room
+	std::size_t size;        // entries in the cache right now
+	std::uint64_t hitNanos;  // total time spent in lookups that hit, in nanoseconds
+	std::uint64_t missNanos; // total time spent in lookups that missed, in nanoseconds
+};
+
+class DecisionCache{
+	public:
+		// What the database says about an id, before occupancy is taken into account
+		enum Decision {
+			Unknown,  // no record has this id
+			Eligible, // the record's holder may be admitted
+			TooSoon   // the record's holder was vaccinated too recently
+		};
+
+		DecisionCache(std::size_t capacity);
+
+		Decision lookup(const std::string &id, std::int64_t now, Record &user);
+		void invalidate(const std::vector<std::string> &ids);
+		void clear();
+		DecisionCacheStats stats() const;
+
+	private:
+		struct Entry {
+			std::string id;
+			Decision decision;
+			Record user;            // the record, whose names are shown on screen
+			std::int64_t expiresAt; // when the decision stops being true, in seconds since the epoch
+		};
+
+		std::list<Entry> entries; // most recently used first
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // keys point into entries
+		std::size_t capacity;
+
+		// Ids changed by the database, waiting to be dropped by the thread using the cache
+		std::mutex pendingLock;
+		std::vector<std::string> pending;
+		std::atomic<bool> hasPending;
+
+		DecisionCacheStats counters;
+
+		void applyInvalidations();
+		void erase(std::unordered_map<std::string_view, std::list<Entry>::iterator>::iterator it);
+};
+
+#endif
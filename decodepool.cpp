@@ -0,0 +1,199 @@
+/**
+ * DecodePool class. Decoding frames that hold codes is the slowest step of the camera
+ * pipeline, and one thread only ever keeps one core busy with it. So frames are decoded
+ * by a pool of workers, by default one per core (see DECODE_WORKERS), each with a
+ * QRTracker of its own. Whenever a worker is free it takes the next frame from the feed,
+ * which for a camera is the freshest frame in the FrameRing; taking frames is done one
+ * worker at a time, so the frames are numbered in the order they were captured.
+ * The trackers share where they last decoded codes: each frame is first decoded in the
+ * regions of the latest frame any worker has finished, so a code tracked by one worker
+ * is not searched for again by the others.
+ * Workers finish out of order, so collect() hands results back by frame number, waiting
+ * for an earlier frame still being decoded before a later one. Consecutive frames show
+ * the same passes, so the codes of every frame ready at once are merged, each code kept
+ * only the first time it appears, before they reach authentication.
+ * @brief Decodes frames on several threads and hands the codes back in frame order.
+ * @author Liam Garrett
+ */
+
+#include "config.h"
+
+#if defined(USING_CAMERA) && defined(USING_NATIVE_CAMERA)
+
+#include "decodepool.h"
+
+#include <algorithm>
+#include <chrono>
+
+/**
+ * Constructor
+ * The workers are not started until start() is called.
+ * @brief Creates a pool of decode workers.
+ * @param workers    How many frames are decoded at once; 0 means one per core.
+ * @param multi      Whether every code in a frame is read, or just one (see QRTracker).
+*/
+DecodePool::DecodePool(std::size_t workers, bool multi){
+	if(workers == 0)
+		workers = std::max(1u, std::thread::hardware_concurrency());
+	for(std::size_t i = 0; i < workers; i++)
+		trackers.emplace_back(new QRTracker(multi));
+	nextFrame = 0;
+	running = 0;
+	regionsFrame = 0;
+	counts = DecodePoolStats();
+}
+
+/**
+ * Destructor
+ * @brief Stops the workers.
+*/
+DecodePool::~DecodePool(){
+	stop();
+}
+
+/**
+ * Starts every worker on the given feed, forgetting the frames, codes and counters of
+ * the last run. The workers stop once the feed has no more frames.
+ * @brief Starts decoding frames from a feed.
+ * @param feed    Where the workers take frames from. It is called by one worker at a time.
+*/
+void DecodePool::start(Feed feed){
+	stop();
+	this->feed = feed;
+	nextFrame = 0;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		results.clear();
+		lastRegions.clear();
+		regionsFrame = 0;
+		running = trackers.size();
+		counts = DecodePoolStats();
+	}
+	for(std::size_t worker = 0; worker < trackers.size(); worker++){
+		trackers[worker]->reset();
+		threads.emplace_back(&DecodePool::work, this, worker);
+	}
+}
+
+/**
+ * Waits until the frames up to the next one holding a code have been decoded, then
+ * takes the results of every frame decoded so far without a gap, in frame order, and
+ * merges their codes.
+ * @brief Takes the next codes read, in the order their frames were taken.
+ * @param data    Set to the payloads read, each once, in the order they first appeared.
+ * @return true if codes were read; false once the workers have run out of frames and
+ *         every frame has been collected.
+*/
+bool DecodePool::collect(std::vector<std::string> &data){
+	data.clear();
+	std::unique_lock<std::mutex> guard(lock);
+	while(true){
+		decoded.wait(guard, [this]{ return (!results.empty() && results.begin()->second.done) || (running == 0 && results.empty()); });
+		while(!results.empty() && results.begin()->second.done){
+			for(std::string &payload : results.begin()->second.data){
+				if(std::find(data.begin(), data.end(), payload) == data.end())
+					data.push_back(std::move(payload));
+				else
+					counts.duplicates++;
+			}
+			results.erase(results.begin());
+		}
+		if(!data.empty())
+			return true;
+		if(running == 0 && results.empty())
+			return false;
+	}
+}
+
+/**
+ * The feed must run out of frames for the workers to finish; for a camera, that means
+ * closing the FrameRing first.
+ * @brief Waits for every worker to finish.
+*/
+void DecodePool::stop(){
+	for(std::thread &thread : threads)
+		thread.join();
+	threads.clear();
+}
+
+/**
+ * @brief Returns how many workers the pool runs.
+ * @return The number of workers.
+*/
+std::size_t DecodePool::size() const{
+	return trackers.size();
+}
+
+/**
+ * The trackers' counters are only safe to read once the workers have finished, i.e.
+ * after collect() has returned false or stop() has returned.
+ * @brief Returns the pool's counters, along with its trackers' summed over the workers.
+ * @return The counters of the last run.
+*/
+DecodePoolStats DecodePool::stats(){
+	std::lock_guard<std::mutex> guard(lock);
+	DecodePoolStats result = counts;
+	for(const std::unique_ptr<QRTracker> &tracker : trackers){
+		QRTrackerStats tracking = tracker->stats();
+		result.tracking.frames += tracking.frames;
+		result.tracking.searches += tracking.searches;
+		result.tracking.located += tracking.located;
+		result.tracking.tracked += tracking.tracked;
+	}
+	return result;
+}
+
+/**
+ * The body of each worker thread. A frame's number is reserved in the results while
+ * the feed lock is still held, so that collect() knows to wait for it, and the regions
+ * of the latest frame decoded are picked up at the same time. Once the frame is decoded,
+ * its regions replace those unless a later frame has been decoded meanwhile.
+ * @brief Takes frames from the feed and decodes them until the feed runs out.
+ * @param worker    The index of the worker, which picks its tracker.
+*/
+void DecodePool::work(std::size_t worker){
+	QRTracker &tracker = *trackers[worker];
+	cv::Mat frame;
+	std::vector<std::string> data;
+	std::vector<cv::Rect> seen;
+	while(true){
+		std::uint64_t number;
+		{
+			std::lock_guard<std::mutex> taking(feedLock);
+			if(!feed(frame))
+				break;
+			number = nextFrame++;
+			std::lock_guard<std::mutex> guard(lock);
+			results[number];
+			seen = lastRegions;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::size_t found = tracker.decode(frame, seen, data);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			Result &result = results[number];
+			result.done = true;
+			result.data.swap(data);
+			if(number >= regionsFrame){
+				lastRegions = tracker.decodedRegions();
+				regionsFrame = number + 1;
+			}
+			counts.frames++;
+			counts.withCode += found > 0;
+			counts.codes += found;
+			counts.busyMilliseconds += milliseconds;
+		}
+		decoded.notify_all();
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		running--;
+	}
+	decoded.notify_all();
+}
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * Header for the DecodePool class, the decode workers of the native camera backend.
+ * Each worker runs its own QRTracker on frames it takes from a feed, starting from the
+ * regions of the latest frame any worker decoded, and the codes they read are handed back
+ * in the order the frames were taken, with duplicates removed.
+ * Only used with USING_NATIVE_CAMERA.
+ * @brief The header file for the decodepool class.
+ * @author Liam Garrett
+ */
+
+#ifndef DECODEPOOL_H
+#define DECODEPOOL_H
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+#include <opencv2/core.hpp>
+
+#include "qrtracker.h"
+
+// Counters describing a DecodePool, see DecodePool::stats()
+struct DecodePoolStats {
+	std::uint64_t frames;     // frames decoded
+	std::uint64_t withCode;   // frames in which at least one code was read
+	std::uint64_t codes;      // codes read, counting a code once per frame it was read in
+	std::uint64_t duplicates; // codes dropped by collect() because an earlier frame it merged had them
+	double busyMilliseconds;  // time spent decoding, summed over the workers
+	QRTrackerStats tracking;  // the trackers' counters, summed over the workers
+};
+
+class DecodePool{
+	public:
+		// Fills in the next frame to decode, waiting for one if need be; false once there are no more
+		typedef std::function<bool(cv::Mat&)> Feed;
+
+		DecodePool(std::size_t workers, bool multi);
+		~DecodePool();
+
+		void start(Feed feed);
+		bool collect(std::vector<std::string> &data);
+		void stop();
+		std::size_t size() const;
+		DecodePoolStats stats();
+
+	private:
+		// What a worker read from one frame
+		struct Result {
+			bool done = false; // the frame has been decoded
+			std::vector<std::string> data;
+		};
+
+		std::vector<std::unique_ptr<QRTracker>> trackers; // One per worker; a detector can't be shared
+		std::vector<std::thread> threads;
+		Feed feed;
+		std::mutex feedLock; // Held while a worker takes a frame, so frames are numbered in the order they are taken
+		std::uint64_t nextFrame; // Number of the next frame taken; guarded by feedLock
+
+		std::mutex lock; // Guards everything below
+		std::condition_variable decoded;
+		std::map<std::uint64_t, Result> results; // Frames taken and not collected yet, by number
+		std::vector<cv::Rect> lastRegions; // Where codes were decoded in the latest frame decoded, shared by the trackers
+		std::uint64_t regionsFrame; // One past the number of the frame lastRegions come from; 0 before any
+		std::size_t running; // Workers that haven't run out of frames
+		DecodePoolStats counts;
+
+		void work(std::size_t worker);
+
+		DecodePool(const DecodePool&) = delete;
+		DecodePool& operator=(const DecodePool&) = delete;
+};
+
+#endif
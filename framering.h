@@ -0,0 +1,145 @@
+/**
+ * Header for the FrameRing class, the ring buffer between the thread that reads
+ * the camera and the thread that decodes QR codes.
+ * The capture thread pushes every frame it reads, and the ring keeps only the
+ * latest few, overwriting the oldest. The decoder always takes the freshest frame
+ * it hasn't seen yet, skipping any that arrived while it was busy, so however slow
+ * decoding gets, the frame it works on is never more than one decode old, and the
+ * capture never waits for it. Frames are handed over by moving them, so with a
+ * reference-counted frame type such as cv::Mat no pixels are copied.
+ * The ring is a template so that it can hold any frame type.
+ * @brief The header file for the framering class.
+ * @author Liam Garrett
+ */
+
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Counters describing a FrameRing, see FrameRing::stats()
+struct FrameRingStats {
+	std::uint64_t pushed;  // frames read from the camera
+	std::uint64_t taken;   // frames handed to the decoder
+	std::uint64_t skipped; // frames overwritten or passed over before the decoder got to them
+};
+
+template<typename Frame>
+class FrameRing{
+	public:
+		/**
+		 * Constructor
+		 * @brief Creates an empty ring.
+		 * @param size    How many of the latest frames the ring holds.
+		 */
+		explicit FrameRing(std::size_t size) : slots(size > 0 ? size : 1){
+			pushed = 0;
+			taken = 0;
+			skipped = 0;
+			lastTaken = 0;
+			closed = false;
+		}
+
+		/**
+		 * Stores a frame as the latest one, overwriting the oldest if the ring is full,
+		 * and wakes the decoder if it is waiting. This never waits for the decoder.
+		 * @brief Push a frame read from the camera.
+		 * @param frame    The frame; it is moved into the ring.
+		 */
+		void push(Frame frame){
+			Frame old;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				pushed++;
+				Slot &slot = slots[pushed % slots.size()];
+				old = std::move(slot.frame); // freed outside the lock
+				slot.frame = std::move(frame);
+				slot.sequence = pushed;
+			}
+			ready.notify_one();
+		}
+
+		/**
+		 * Waits until a frame newer than the last one taken has been pushed, then takes
+		 * the newest frame; any older ones not taken yet are skipped.
+		 * @brief Take the freshest frame.
+		 * @param frame      Receives the frame.
+		 * @param timeout    The longest to wait for a new frame.
+		 * @return true if a frame was taken; false on timeout, or once the ring is closed.
+		 */
+		bool takeLatest(Frame &frame, std::chrono::milliseconds timeout){
+			std::unique_lock<std::mutex> guard(lock);
+			if(!ready.wait_for(guard, timeout, [this]{ return closed || pushed > lastTaken; }) || closed)
+				return false;
+
+			Slot &slot = slots[pushed % slots.size()];
+			skipped += slot.sequence - lastTaken - 1;
+			lastTaken = slot.sequence;
+			taken++;
+			frame = std::move(slot.frame);
+			return true;
+		}
+
+		/**
+		 * @brief Wake the decoder and make takeLatest() fail until reopen(), e.g. when the camera stops.
+		 */
+		void close(){
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				closed = true;
+			}
+			ready.notify_all();
+		}
+
+		/**
+		 * @brief Empty the ring and accept frames again after close(), e.g. at the start of a session.
+		 */
+		void reopen(){
+			std::lock_guard<std::mutex> guard(lock);
+			for(Slot &slot : slots)
+				slot = Slot();
+			pushed = 0;
+			taken = 0;
+			skipped = 0;
+			lastTaken = 0;
+			closed = false;
+		}
+
+		/**
+		 * @brief Get the ring's frame counters.
+		 * @return The current counters.
+		 */
+		FrameRingStats stats(){
+			std::lock_guard<std::mutex> guard(lock);
+			FrameRingStats result;
+			result.pushed = pushed;
+			result.taken = taken;
+			result.skipped = skipped;
+			return result;
+		}
+
+	private:
+		struct Slot {
+			Frame frame;
+			std::uint64_t sequence = 0; // which push stored the frame, counting from 1
+		};
+
+		std::vector<Slot> slots; // the frame of push n is in slot n % size
+		std::mutex lock;
+		std::condition_variable ready;
+		std::uint64_t pushed;
+		std::uint64_t taken;
+		std::uint64_t skipped;
+		std::uint64_t lastTaken; // sequence of the last frame taken
+		bool closed;
+
+		FrameRing(const FrameRing&) = delete;
+		FrameRing& operator=(const FrameRing&) = delete;
+};
+
+#endif
@@ -0,0 +1,232 @@
+/**
+ * FrameSource classes. The native camera backend reads its frames through this
+ * interface, so it can decode a live camera, a video file or a directory of images
+ * alike (see FrameSource::create()). In a scanning session, recorded frames are paced
+ * at their frame rate, as if they came from a camera; when replaying to measure the
+ * decoder (see Camera::replay()), they are handed out as fast as they can be read.
+ * @brief Where the native camera backend gets its frames.
+ * @author Liam Garrett
+ */
+
+#include "config.h"
+
+#if defined(USING_CAMERA) && defined(USING_NATIVE_CAMERA)
+
+#include "framesource.h"
+
+#include <algorithm>
+#include <cctype>
+#include <thread>
+#include <filesystem>
+#include <opencv2/imgcodecs.hpp>
+
+/**
+ * Constructor
+ * @brief Sets up pacing, at 30 frames per second until the source knows better.
+ * @param paced    Whether read() waits for the frame's time to come.
+*/
+FrameSource::FrameSource(bool paced){
+	this->paced = paced;
+	frameInterval = std::chrono::milliseconds(1000 / 30);
+}
+
+/**
+ * Destructor
+ * @brief Destroys the source.
+*/
+FrameSource::~FrameSource(){
+}
+
+/**
+ * Chooses the source a spec describes: a number (or nothing) is a camera device, a
+ * directory is an image sequence, and anything else is a video file.
+ * @brief Creates a frame source from a spec such as CAMERA_SOURCE in config.h.
+ * @param spec     The device number, directory or video file.
+ * @param paced    Whether recorded frames are paced at their frame rate, or read at full speed.
+ * @return The source, not opened yet.
+*/
+std::unique_ptr<FrameSource> FrameSource::create(const std::string &spec, bool paced){
+	if(spec.empty())
+		return std::unique_ptr<FrameSource>(new DeviceSource(0));
+	if(std::all_of(spec.begin(), spec.end(), [](unsigned char c){ return std::isdigit(c); }))
+		return std::unique_ptr<FrameSource>(new DeviceSource(std::stoi(spec)));
+	std::error_code error;
+	if(std::filesystem::is_directory(spec, error))
+		return std::unique_ptr<FrameSource>(new ImageDirSource(spec, paced));
+	return std::unique_ptr<FrameSource>(new VideoFileSource(spec, paced));
+}
+
+/**
+ * Called by read() of recorded sources before handing out a frame. The first frame
+ * goes out at once; each later one waits until a frame interval after the one before,
+ * unless the reader fell behind, in which case it goes out straight away.
+ * @brief Waits until the next frame is due, if the source is paced.
+*/
+void FrameSource::pace(){
+	if(!paced)
+		return;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if(nextFrame > now)
+		std::this_thread::sleep_until(nextFrame);
+	else
+		nextFrame = now;
+	nextFrame += frameInterval;
+}
+
+/**
+ * Constructor
+ * @brief Creates a source for a camera device.
+ * @param index    The device number, 0 for the default camera.
+*/
+DeviceSource::DeviceSource(int index) : FrameSource(false){
+	this->index = index;
+}
+
+/**
+ * @brief Opens the camera.
+ * @return true if the camera could be opened.
+*/
+bool DeviceSource::open(){
+	return capture.open(index);
+}
+
+/**
+ * The camera delivers frames at its own pace, so this blocks until the next one.
+ * @brief Reads the next frame.
+ * @param frame    Receives the frame.
+ * @return true if a frame was read, false if the camera stopped delivering frames.
+*/
+bool DeviceSource::read(cv::Mat &frame){
+	return capture.read(frame) && !frame.empty();
+}
+
+/**
+ * @brief Releases the camera.
+*/
+void DeviceSource::close(){
+	capture.release();
+}
+
+/**
+ * @brief Describes the source for reports.
+ * @return The device number.
+*/
+std::string DeviceSource::describe() const{
+	return "camera " + std::to_string(index);
+}
+
+/**
+ * Constructor
+ * @brief Creates a source for a video file.
+ * @param path     The video file.
+ * @param paced    Whether frames are handed out at the video's frame rate.
+*/
+VideoFileSource::VideoFileSource(const std::string &path, bool paced) : FrameSource(paced){
+	this->path = path;
+}
+
+/**
+ * @brief Opens the video file, and paces it at its own frame rate if it has one.
+ * @return true if the file could be opened.
+*/
+bool VideoFileSource::open(){
+	if(!capture.open(path))
+		return false;
+	double fps = capture.get(cv::CAP_PROP_FPS);
+	if(fps > 0)
+		frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1 / fps));
+	nextFrame = std::chrono::steady_clock::now();
+	return true;
+}
+
+/**
+ * @brief Reads the next frame of the video.
+ * @param frame    Receives the frame.
+ * @return true if a frame was read, false at the end of the video.
+*/
+bool VideoFileSource::read(cv::Mat &frame){
+	if(!capture.read(frame) || frame.empty())
+		return false;
+	pace();
+	return true;
+}
+
+/**
+ * @brief Closes the video file.
+*/
+void VideoFileSource::close(){
+	capture.release();
+}
+
+/**
+ * @brief Describes the source for reports.
+ * @return The path of the video.
+*/
+std::string VideoFileSource::describe() const{
+	return "video " + path;
+}
+
+/**
+ * Constructor
+ * @brief Creates a source for a directory of images.
+ * @param path     The directory.
+ * @param paced    Whether images are handed out at DEFAULT_FPS.
+*/
+ImageDirSource::ImageDirSource(const std::string &path, bool paced) : FrameSource(paced){
+	this->path = path;
+	next = 0;
+	frameInterval = std::chrono::milliseconds(1000 / DEFAULT_FPS);
+}
+
+/**
+ * Lists the regular files in the directory, sorted by name so that numbered frames
+ * play in order. Files that turn out not to be images are skipped by read().
+ * @brief Opens the directory.
+ * @return true if the directory holds at least one file.
+*/
+bool ImageDirSource::open(){
+	files.clear();
+	next = 0;
+	std::error_code error;
+	for(const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(path, error)){
+		if(entry.is_regular_file(error))
+			files.push_back(entry.path().string());
+	}
+	std::sort(files.begin(), files.end());
+	nextFrame = std::chrono::steady_clock::now();
+	return !files.empty();
+}
+
+/**
+ * @brief Reads the next image in the directory.
+ * @param frame    Receives the image.
+ * @return true if an image was read, false once every file has been read.
+*/
+bool ImageDirSource::read(cv::Mat &frame){
+	while(next < files.size()){
+		frame = cv::imread(files[next++]);
+		if(!frame.empty()){
+			pace();
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Forgets the directory's files.
+*/
+void ImageDirSource::close(){
+	files.clear();
+	next = 0;
+}
+
+/**
+ * @brief Describes the source for reports.
+ * @return The path of the directory.
+*/
+std::string ImageDirSource::describe() const{
+	return "images in " + path;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * Header for the FrameSource classes, which supply the frames the native camera
+ * backend decodes. Besides a live camera, frames can come from a video file or a
+ * directory of images, so decoding can be run and measured from recorded footage.
+ * Only used with USING_NATIVE_CAMERA.
+ * @brief The header file for the framesource classes.
+ * @author Liam Garrett
+ */
+
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+class FrameSource{
+	public:
+		virtual ~FrameSource();
+
+		virtual bool open() = 0;
+		virtual bool read(cv::Mat &frame) = 0;
+		virtual void close() = 0;
+		virtual std::string describe() const = 0;
+
+		static std::unique_ptr<FrameSource> create(const std::string &spec, bool paced);
+
+	protected:
+		bool paced; // Recorded frames are handed out no faster than they were recorded
+		std::chrono::steady_clock::duration frameInterval;
+		std::chrono::steady_clock::time_point nextFrame;
+
+		FrameSource(bool paced);
+		void pace();
+};
+
+// A camera attached to the machine
+class DeviceSource : public FrameSource{
+	public:
+		DeviceSource(int index);
+		bool open();
+		bool read(cv::Mat &frame);
+		void close();
+		std::string describe() const;
+
+	private:
+		int index;
+		cv::VideoCapture capture;
+};
+
+// A recorded video file, played once from start to end
+class VideoFileSource : public FrameSource{
+	public:
+		VideoFileSource(const std::string &path, bool paced);
+		bool open();
+		bool read(cv::Mat &frame);
+		void close();
+		std::string describe() const;
+
+	private:
+		std::string path;
+		cv::VideoCapture capture;
+};
+
+// Every image in a directory, in file name order
+class ImageDirSource : public FrameSource{
+	public:
+		ImageDirSource(const std::string &path, bool paced);
+		bool open();
+		bool read(cv::Mat &frame);
+		void close();
+		std::string describe() const;
+
+	private:
+		std::string path;
+		std::vector<std::string> files;
+		std::size_t next;
+
+		static const int DEFAULT_FPS = 30; // Pace for images, which carry no frame rate
+};
+
+#endif
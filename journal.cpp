@@ -0,0 +1,209 @@
+/**
+ * The journal of the vax database.
+ * Every change made to the database is appended to the journal as a single line instead of
+ * rewriting the whole database file, so an edit costs one small write on disk.
+ * On startup the journal is replayed on top of the database file, and it is periodically
+ * folded back into that file by the database's compaction.
+ * Entries take one of three forms:
+ *   +,id,first,last,date          put the record (insert, or overwrite the record with that id)
+ *   -,id                          remove the record with that id
+ *   =,oldId,id,first,last,date    remove oldId, then put the record
+ * Each entry gives the final state of the ids it names, so replaying a journal over a state
+ * that already contains some of its entries is harmless.
+ * @brief An append-only log of changes to the vax database.
+ * @author Justin Teichman
+ * */
+#include <journal.h>
+#include <vector>
+#include <cstdio>
+#include <unistd.h>
+
+/**
+ * Constructor
+ * The journal is not opened until open() is called.
+ * @brief Creates a journal stored at the given path.
+ * @param file The path of the journal file.
+ * */
+Journal::Journal(std::string file){
+    path = file;
+    count = 0;
+    batching = false;
+}
+
+/**
+ * Opens the journal file for appending, creating it if needed, and counts the entries already in it.
+ * An entry is only complete once its newline is written, so if the last entry was cut short
+ * (e.g. by a power loss) it is truncated away before anything new is appended.
+ * @brief Opens the journal for appending.
+ * */
+void Journal::open(){
+
+    std::ifstream fin(path);
+    std::string line;
+    std::streamoff complete = 0;
+    bool torn = false;
+    count = 0;
+    while(getline(fin, line)){
+        if(fin.eof()){
+            torn = true;
+        }else{
+            complete = fin.tellg();
+            count++;
+        }
+    }
+    fin.close();
+
+    if(torn){
+        truncate(path.c_str(), complete);
+    }
+    out.open(path, std::ios::app);
+}
+
+/**
+ * @brief Closes the journal file.
+ * */
+void Journal::close(){
+    out.close();
+}
+
+/**
+ * @brief Appends an entry putting the given record.
+ * @param rec The record that was added.
+ * */
+void Journal::logPut(const Record& rec){
+    append("+," + fields(rec));
+}
+
+/**
+ * @brief Appends an entry removing the record with the given id.
+ * @param id The id of the record that was deleted.
+ * */
+void Journal::logRemove(const std::string& id){
+    append("-," + id);
+}
+
+/**
+ * @brief Appends an entry replacing the record with the given id.
+ * @param id The id of the record that was edited.
+ * @param rec The record that replaced it.
+ * */
+void Journal::logReplace(const std::string& id, const Record& rec){
+    append("=," + id + "," + fields(rec));
+}
+
+/**
+ * Starts a batch of entries. Entries appended until endBatch() is called are buffered and
+ * written out together, instead of flushing the file once per entry.
+ * @brief Starts buffering entries.
+ * */
+void Journal::beginBatch(){
+    batching = true;
+}
+
+/**
+ * @brief Ends a batch of entries and flushes them to the file.
+ * */
+void Journal::endBatch(){
+    batching = false;
+    out.flush();
+}
+
+/**
+ * @brief Returns the number of entries in the journal file.
+ * @return The number of entries replayed from or appended to the current file.
+ * */
+std::size_t Journal::entries() const{
+    return count;
+}
+
+/**
+ * Closes the journal, moves its file to the given path and starts a new, empty journal in its place.
+ * Entries appended afterwards go to the new file, so the sealed one can be folded into the
+ * database file while edits continue.
+ * @brief Seals the current journal file under a new name.
+ * @param sealedPath The path the current journal file is moved to.
+ * @return true if the journal was sealed, false if the file could not be moved.
+ * */
+bool Journal::seal(std::string sealedPath){
+
+    out.close();
+    bool moved = rename(path.c_str(), sealedPath.c_str()) == 0;
+    open();
+    return moved;
+}
+
+/**
+ * Applies every entry of a journal file to the given store, in order.
+ * Malformed entries, and a final entry cut short by a crash (one missing its newline), are skipped.
+ * @brief Replays a journal file into a record store.
+ * @param file The path of the journal file.
+ * @param store The store to apply the entries to.
+ * @return The number of entries applied.
+ * */
+std::size_t Journal::replay(std::string file, RecordStore& store){
+
+    std::ifstream fin(file);
+    std::string line;
+    std::size_t applied = 0;
+
+    while(getline(fin, line) && !fin.eof()){
+
+        std::vector<std::string> field;
+        std::size_t start = 0, end;
+        while((end = line.find(',', start)) != std::string::npos){
+            field.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+        field.push_back(line.substr(start));
+
+        if(field[0] == "+" && field.size() == 5){
+            Record rec(field[1], field[2], field[3], field[4]);
+            if(!store.replace(rec.getId(), rec)){
+                store.insert(rec);
+            }
+        }else if(field[0] == "-" && field.size() == 2){
+            store.remove(field[1]);
+        }else if(field[0] == "=" && field.size() == 6){
+            Record rec(field[2], field[3], field[4], field[5]);
+            store.remove(field[1]);
+            if(!store.replace(rec.getId(), rec)){
+                store.insert(rec);
+            }
+        }else{
+            continue;
+        }
+        applied++;
+    }
+    return applied;
+}
+
+/**
+ * Writes an entry followed by a newline and, unless a batch is in progress, flushes it to
+ * the file straight away.
+ * @brief Appends a line to the journal.
+ * @param entry The entry to write.
+ * */
+void Journal::append(const std::string& entry){
+    out << entry << '\n';
+    if(!batching){
+        out.flush();
+    }
+    count++;
+}
+
+/**
+ * @brief Formats a record as comma separated fields, as in the database file.
+ * @param rec The record to format.
+ * @return The fields of the record.
+ * */
+std::string Journal::fields(const Record& rec){
+    return std::string(rec.getId()) + "," + rec.getfName() + "," + rec.getlName() + "," + std::string(rec.getDate());
+}
+
+/**
+ * Destructor
+ * @brief Closes the journal file.
+ * */
+Journal::~Journal(){
+    out.close();
+}
@@ -0,0 +1,44 @@
+/**
+ * The header file for the journal class.
+ * This stores the declarations of the append-only log of changes made to the vax database.
+ * @brief The header file for the journal class.
+ * @author Justin Teichman
+ * */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <record.h>
+#include <recordstore.h>
+#include <string>
+#include <fstream>
+
+class Journal {
+
+    public:
+        Journal(std::string);
+        ~Journal();
+
+        void open();
+        void close();
+        void logPut(const Record&);
+        void logRemove(const std::string&);
+        void logReplace(const std::string&, const Record&);
+        void beginBatch();
+        void endBatch();
+        std::size_t entries() const;
+        bool seal(std::string);
+
+        static std::size_t replay(std::string, RecordStore&);
+
+    private:
+        std::string path;
+        std::ofstream out;
+        std::size_t count;
+        bool batching;
+
+        void append(const std::string&);
+        static std::string fields(const Record&);
+};
+
+#endif
@@ -13,12 +13,24 @@ using namespace std;
 /**
  * The main driver of the program.
  * Only calls other functions.
+ * When started with --import or --export, it converts between the text database
+ * and its binary snapshot instead of opening the UI. With the camera module, --replay
+ * measures how fast QR codes are decoded from a video file or a directory of images.
  * @brief Calls other methods to do all the work of the system.
  * @param argc The length of the argument array.
  * @param argv The argument array.
  * @return The return code of the system.
  * */
 int main(int argc, char **argv){
+	if(argc == 4 && string(argv[1]) == "--import")
+		return Database::importText(argv[2], argv[3]) ? 0 : 1;
+	if(argc == 4 && string(argv[1]) == "--export")
+		return Database::exportText(argv[2], argv[3]) ? 0 : 1;
+	#ifdef USING_CAMERA
+	if(argc == 3 && string(argv[1]) == "--replay")
+		return Camera::replay(argv[2]) ? 0 : 1;
+	#endif
+
 	Database::instance();
 	QApplication app(argc, argv);
 	Window &w = Window::getInstance();
@@ -0,0 +1,102 @@
+/**
+ * A read-only, memory-mapped view of a file.
+ * The file's contents are mapped straight into memory, so they can be parsed in place
+ * without copying them through a stream buffer first. The mapping is released when the
+ * object is closed or destroyed.
+ * @brief A file mapped into memory for reading.
+ * @author Justin Teichman
+ * */
+#include <mappedfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Constructor
+ * @brief Creates a mapped file with nothing mapped yet.
+ * */
+MappedFile::MappedFile(){
+    addr = nullptr;
+    length = 0;
+}
+
+/**
+ * Maps the whole of the given file into memory, replacing any file mapped before.
+ * An empty file opens successfully with nothing mapped.
+ * @brief Maps a file into memory.
+ * @param path The path of the file to map.
+ * @return true if the file was mapped, false if it could not be opened or mapped.
+ * */
+bool MappedFile::open(const std::string& path){
+
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        ::close(fd);
+        return false;
+    }
+
+    if(info.st_size > 0){
+        void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED){
+            ::close(fd);
+            return false;
+        }
+        madvise(mapped, info.st_size, MADV_SEQUENTIAL); // the file is parsed front to back
+        addr = mapped;
+        length = info.st_size;
+    }
+
+    ::close(fd); // the mapping stays valid after the descriptor is closed
+    return true;
+}
+
+/**
+ * @brief Unmaps the file, if one is mapped.
+ * */
+void MappedFile::close(){
+    if(addr != nullptr){
+        munmap(addr, length);
+    }
+    addr = nullptr;
+    length = 0;
+}
+
+/**
+ * @brief Returns the first byte of the mapped file.
+ * @return A pointer to the file's contents, or nullptr if nothing is mapped.
+ * */
+const char* MappedFile::data() const{
+    return static_cast<const char*>(addr);
+}
+
+/**
+ * @brief Returns the size of the mapped file.
+ * @return The number of bytes mapped.
+ * */
+std::size_t MappedFile::size() const{
+    return length;
+}
+
+/**
+ * @brief Returns the contents of the mapped file as a string view.
+ * @return A view over the mapped bytes, valid until the file is closed.
+ * */
+std::string_view MappedFile::view() const{
+    return std::string_view(data(), length);
+}
+
+/**
+ * Destructor
+ * @brief Unmaps the file.
+ * */
+MappedFile::~MappedFile(){
+    close();
+}
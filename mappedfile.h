@@ -0,0 +1,35 @@
+/**
+ * The header file for the mapped file class.
+ * This stores the declarations of a read-only, memory-mapped view of a file.
+ * @brief The header file for the mappedfile class.
+ * @author Justin Teichman
+ * */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+
+class MappedFile {
+
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool open(const std::string&);
+        void close();
+
+        const char* data() const;
+        std::size_t size() const;
+        std::string_view view() const;
+
+    private:
+        void *addr;
+        std::size_t length;
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+};
+
+#endif
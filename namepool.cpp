@@ -0,0 +1,100 @@
+/**
+ * The pool of strings held by records.
+ * The same first names, last names and dates occur over and over in the vax database, so
+ * rather than every record owning its own copies, each distinct string is stored once here
+ * and records hold a pointer to it. Because each string is stored only once, two interned
+ * strings are equal exactly when their pointers are, so comparing or hashing them never has
+ * to look at their characters. Interned strings are never freed or moved, so the pointers
+ * stay valid for the life of the program.
+ * The pool uses a singleton design pattern, and is safe to use from several threads at once.
+ * @brief Stores each distinct record string once.
+ * @author Justin Teichman
+ * */
+#include <namepool.h>
+
+/**
+ * Singleton constructor
+ * Only once instance of the name pool can ever exist at once because of its use of the singleton design pattern.
+ * @brief Returns a reference to the sole instance of the name pool.
+ * @return The instance of the name pool.
+ * */
+NamePool& NamePool::instance(){
+    static NamePool pool;
+    return pool;
+}
+
+/**
+ * Constructor
+ * @brief Creates an empty name pool.
+ * */
+NamePool::NamePool(){
+
+}
+
+/**
+ * Returns the pooled copy of a string, adding it to the pool if it is not there yet.
+ * @brief Interns a string.
+ * @param text The string to intern.
+ * @return A pointer to the pooled string, valid for the life of the program.
+ * */
+const std::string* NamePool::intern(std::string_view text){
+    Shard& shard = shardFor(text);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.index.find(text);
+    if(it != shard.index.end()){
+        return it->second;
+    }
+    const std::string *name = &shard.names.emplace_back(text);
+    shard.index.emplace(*name, name);
+    return name;
+}
+
+/**
+ * Looks a string up without adding it. A string that is not in the pool cannot be held by any record.
+ * @brief Finds the pooled copy of a string.
+ * @param text The string to look up.
+ * @return A pointer to the pooled string, or nullptr if it is not in the pool.
+ * */
+const std::string* NamePool::find(std::string_view text){
+    Shard& shard = shardFor(text);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.index.find(text);
+    return it == shard.index.end() ? nullptr : it->second;
+}
+
+/**
+ * @brief Returns the number of distinct strings in the pool.
+ * @return The number of strings.
+ * */
+std::size_t NamePool::size(){
+    std::size_t count = 0;
+    for(Shard& shard : shards){
+        std::lock_guard<std::mutex> guard(shard.lock);
+        count += shard.names.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the number of characters stored in the pool.
+ * @return The total length of every string in the pool.
+ * */
+std::size_t NamePool::bytes(){
+    std::size_t count = 0;
+    for(Shard& shard : shards){
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for(const std::string& name : shard.names){
+            count += name.size();
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Picks the shard a string belongs in.
+ * @param text The string.
+ * @return The shard holding that string, if it is pooled.
+ * */
+NamePool::Shard& NamePool::shardFor(std::string_view text){
+    return shards[std::hash<std::string_view>()(text) % SHARDS];
+}
@@ -0,0 +1,50 @@
+/**
+ * The header file for the name pool.
+ * This stores the declarations of the pool that interns the strings held by records.
+ * @brief The header file for the namepool class.
+ * @author Justin Teichman
+ * */
+
+#ifndef NAMEPOOL_H
+#define NAMEPOOL_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+
+class NamePool {
+
+    public:
+        static NamePool& instance();
+
+        const std::string* intern(std::string_view);
+        const std::string* find(std::string_view);
+        std::size_t size();
+        std::size_t bytes();
+
+    protected:
+        NamePool();
+
+    private:
+        static const int SHARDS = 16;
+
+        // The pool is split into shards, each with its own lock, so records can be
+        // built on several threads at once without all waiting on the same lock.
+        // The strings live in a deque, which never moves them as it grows, and are looked
+        // up through views of their characters, so a lookup never has to build a string
+        struct Shard {
+            std::mutex lock;
+            std::deque<std::string> names;
+            std::unordered_map<std::string_view, const std::string*> index;
+        };
+
+        Shard shards[SHARDS];
+
+        Shard& shardFor(std::string_view);
+        NamePool(const NamePool&) = delete;
+        NamePool& operator=(const NamePool&) = delete;
+};
+
+#endif
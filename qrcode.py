@@ -1,31 +1,334 @@
 import cv2
 import re
-#import the two libraries 
+import os
+import sys
+import time
+import threading
+import collections
+#import the libraries 
+
+# A capture thread reads frames as fast as the camera delivers them and keeps the latest
+# FRAME_RING_SIZE of them, while func() decodes the freshest one, skipping any that arrived
+# during the last decode. A slow decode therefore never stalls the capture or lets stale
+# frames pile up in the driver's buffer. The capture stays open between scans, so only the
+# first scan of a session waits for the camera to start (see start_capture() and stop_capture()).
+FRAME_RING_SIZE = 4
+
+# Each frame is first searched for a code on a grayscale copy scaled down to DETECT_WIDTH pixels
+# wide, which is cheap and finds nothing on most frames. Only the region around a code found
+# there, widened by REGION_MARGIN of its size on each side, is decoded at full resolution. That
+# region is remembered, and the next frame is decoded there straight away, since a pass held up
+# to the camera barely moves between frames; the search runs again only when that fails.
+DETECT_WIDTH = 480 # 0 searches frames at full resolution
+REGION_MARGIN = 0.25
+
+# Every code in a frame is decoded, so a group holding up their passes together is let through at
+# once (func() returns them all). While every code is tracked, the frame is still searched every
+# SEARCH_INTERVAL frames for codes coming into view.
+MULTI_CODE = True
+MAX_CODES = 8 # most codes read from one frame
+SEARCH_INTERVAL = 5
+
+# Frames are decoded by DECODE_WORKERS threads at once, each taking the freshest frame whenever it
+# is free (cv2 releases the interpreter lock while it decodes). Their results are handed back to
+# func() in frame order, with the codes of frames finished together merged (see DecodePool).
+DECODE_WORKERS = os.cpu_count() or 1
+REPLAY_WORKERS = 4 # the most decode workers replay() measures
+
+cap = None
+decoders = None
+capture_thread = None
+capturing = False
+frames = collections.deque(maxlen=FRAME_RING_SIZE) # (sequence, frame) pairs, newest last
+frame_ready = threading.Condition()
+frame_interval = 0 # seconds between two frames of a recorded source, 0 for a live camera
+last_taken = 0 # sequence of the last frame decoded
+stats = {"captured": 0, "decoded": 0, "skipped": 0}
+
+class ImageDirCapture: # every image in a directory, in file name order, read like a cv2.VideoCapture
+    def __init__(self, path):
+        self.files = sorted(os.path.join(path, name) for name in os.listdir(path))
+        self.next = 0
+
+    def read(self):
+        while self.next < len(self.files):
+            img = cv2.imread(self.files[self.next])
+            self.next += 1
+            if img is not None: # skip files that aren't images
+                return True, img
+        return False, None
+
+    def get(self, prop):
+        return 0
+
+    def release(self):
+        pass
+
+class Tracker: # finds codes on a downscaled frame, decodes them in their regions at full resolution, and follows those regions
+    def __init__(self, multi=MULTI_CODE):
+        self.detector = cv2.QRCodeDetector()
+        self.multi = multi
+        self.reset()
+
+    def reset(self):
+        self.regions = [] # (x, y, w, h) of the codes decoded in the latest frame, in full-resolution pixels
+        self.since_search = 0
+        self.stats = {"frames": 0, "searches": 0, "located": 0, "tracked": 0}
+
+    def decode(self, img, seen): # returns the text of every code decoded, each once, and their corners in img
+        # seen: the regions of the latest frame decoded before this one, which self.regions holds afterwards
+        self.stats["frames"] += 1
+        gray = cv2.cvtColor(img, cv2.COLOR_BGR2GRAY) if img.ndim == 3 else img
+        found = []
+        self.regions = []
+        lost = not seen
+        for region in seen:
+            if self.decode_region(gray, region, found):
+                self.stats["tracked"] += 1
+            else:
+                lost = True # the code moved out of its region, or out of view
+        if not lost and self.multi:
+            self.since_search += 1
+        if lost or (self.multi and self.since_search >= SEARCH_INTERVAL):
+            self.search(gray, found)
+        return [data for data, _ in found], [corners for _, corners in found]
+
+    def search(self, gray, found): # look for codes that aren't tracked yet on the downscaled frame
+        # With MULTI_CODE, each code found or already decoded is painted over and the search repeated,
+        # since on a downscaled frame cv2's detectMulti finds only some of the codes this does.
+        self.stats["searches"] += 1
+        self.since_search = 0
+        scale = DETECT_WIDTH / gray.shape[1] if 0 < DETECT_WIDTH < gray.shape[1] else 1
+        if scale < 1:
+            small = cv2.resize(gray, None, fx=scale, fy=scale, interpolation=cv2.INTER_AREA)
+        else:
+            small = gray.copy() if self.multi else gray
+        if self.multi:
+            for region in self.regions:
+                self.hide(small, region, scale)
+        for _ in range(MAX_CODES if self.multi else 1):
+            if len(found) >= MAX_CODES:
+                break
+            ok, points = self.detector.detect(small)
+            if not ok or points is None:
+                break
+            corners = points.reshape(-1, 2) / scale
+            region = self.bound(corners, gray.shape)
+            if self.plausible(corners) and self.decode_region(gray, region, found):
+                self.stats["located"] += 1
+            if self.multi:
+                self.hide(small, region, scale)
+
+    def decode_region(self, gray, region, found): # decode a code not decoded yet in this frame within one region
+        x, y, w, h = region
+        data, points, _ = self.detector.detectAndDecode(gray[y:y+h, x:x+w])
+        if not data or points is None or any(data == seen for seen, _ in found):
+            return False
+        corners = points.reshape(-1, 2) + (x, y)
+        self.regions.append(self.bound(corners, gray.shape)) # follow the code as it moves
+        found.append((data, corners))
+        return True
+
+    @staticmethod
+    def hide(small, region, scale): # paint a code over on the downscaled frame, leaving the margin of its region alone
+        x, y, w, h = region
+        inset = REGION_MARGIN / (1 + 2 * REGION_MARGIN)
+        x0, y0 = int((x + w * inset) * scale), int((y + h * inset) * scale)
+        x1, y1 = int((x + w - w * inset) * scale) + 1, int((y + h - h * inset) * scale) + 1
+        small[max(0, y0):y1, max(0, x0):x1] = 128
+
+    @staticmethod
+    def plausible(corners): # a code seen at an angle is still a convex quad with sides of similar length
+        sides = [cv2.norm(corners[i] - corners[i - 1]) for i in range(len(corners))]
+        return len(corners) == 4 and cv2.isContourConvex(corners.astype("float32")) and min(sides) * 2 >= max(sides)
+
+    @staticmethod
+    def bound(corners, shape): # the box around the corners, widened by REGION_MARGIN and kept inside the frame
+        left, top = corners.min(axis=0)
+        right, bottom = corners.max(axis=0)
+        margin_x, margin_y = (right - left) * REGION_MARGIN, (bottom - top) * REGION_MARGIN
+        x0, y0 = max(0, int(left - margin_x)), max(0, int(top - margin_y))
+        x1, y1 = min(shape[1], int(right + margin_x) + 1), min(shape[0], int(bottom + margin_y) + 1)
+        return (x0, y0, x1 - x0, y1 - y0)
+
+class DecodePool: # decodes frames from feed() on several threads, handing the codes back in frame order
+    def __init__(self, workers, multi=MULTI_CODE):
+        self.trackers = [Tracker(multi) for _ in range(max(1, workers))] # a detector can't be shared
+        self.threads = []
+        self.take_lock = threading.Lock() # held while a worker takes a frame, so frames are numbered in the order taken
+        # The workers share the regions of the latest frame decoded, so each frame is first decoded where any worker last found codes
+        self.decoded = threading.Condition()
+
+    def start(self, feed): # feed() returns the next frame, waiting for one if need be, or None once there are no more
+        self.stop()
+        self.feed = feed
+        self.next = 0 # number of the next frame taken
+        self.first = 0 # number of the next frame to collect
+        self.results = {} # frames taken and not collected yet, by number; None until decoded
+        self.regions = [] # where codes were decoded in the latest frame decoded
+        self.regions_frame = 0 # one past the number of the frame self.regions come from
+        self.running = len(self.trackers)
+        self.stats = {"frames": 0, "with_code": 0, "codes": 0, "duplicates": 0, "busy": 0.0}
+        for tracker in self.trackers:
+            tracker.reset()
+            self.threads.append(threading.Thread(target=self.work, args=(tracker,), daemon=True))
+            self.threads[-1].start()
+
+    def work(self, tracker):
+        while True:
+            with self.take_lock:
+                img = self.feed()
+                if img is None:
+                    break
+                number = self.next
+                self.next += 1
+                with self.decoded:
+                    self.results[number] = None # collect() waits for it
+                    seen = self.regions
+            start = time.perf_counter()
+            data, corners = tracker.decode(img, seen)
+            busy = time.perf_counter() - start
+            with self.decoded:
+                self.results[number] = (img, data, corners)
+                if number >= self.regions_frame: # unless a later frame was decoded meanwhile
+                    self.regions = tracker.regions
+                    self.regions_frame = number + 1
+                self.stats["frames"] += 1
+                self.stats["with_code"] += bool(data)
+                self.stats["codes"] += len(data)
+                self.stats["busy"] += busy
+                self.decoded.notify_all()
+        with self.decoded:
+            self.running -= 1
+            self.decoded.notify_all()
+
+    def collect(self): # the frames decoded so far without a gap, merged: (last frame, payloads each once, their corners), or None once done
+        with self.decoded:
+            self.decoded.wait_for(lambda: self.results.get(self.first) is not None or (not self.running and not self.results))
+            if self.results.get(self.first) is None:
+                return None # the workers ran out of frames, and every frame has been collected
+            img, data, corners = None, [], []
+            while self.results.get(self.first) is not None:
+                img, frame_data, frame_corners = self.results.pop(self.first)
+                self.first += 1
+                for code, bbox in zip(frame_data, frame_corners):
+                    if code in data:
+                        self.stats["duplicates"] += 1
+                    else:
+                        data.append(code)
+                        corners.append(bbox)
+            return img, data, corners
+
+    def stop(self): # wait for the workers, once the feed has run out of frames
+        for thread in self.threads:
+            thread.join()
+        self.threads = []
+
+    def tracking(self): # the trackers' counters, summed over the workers
+        return {key: sum(tracker.stats[key] for tracker in self.trackers) for key in ("frames", "searches", "located", "tracked")}
+
+def open_source(source): # a camera number, a directory of images, or a video file
+    if source == "" or source.isdigit():
+        return cv2.VideoCapture(int(source or 0))
+    if os.path.isdir(source):
+        return ImageDirCapture(source)
+    return cv2.VideoCapture(source)
+
+def capture_loop():
+    global capturing
+    sequence = 0
+    next_frame = time.monotonic()
+    while capturing:
+        ok, img = cap.read() # cv2 releases the interpreter lock while it waits for the camera
+        if not ok:
+            break
+        if frame_interval: # play recordings at their own frame rate, as a camera would
+            next_frame += frame_interval
+            time.sleep(max(0, next_frame - time.monotonic()))
+        sequence += 1
+        with frame_ready:
+            frames.append((sequence, img))
+            stats["captured"] = sequence
+            frame_ready.notify()
+    with frame_ready:
+        capturing = False
+        frame_ready.notify()
+
+def take_latest():
+    global last_taken
+    with frame_ready:
+        frame_ready.wait_for(lambda: not capturing or (frames and frames[-1][0] > last_taken))
+        if not frames or frames[-1][0] <= last_taken:
+            return None # the capture stopped
+        sequence, img = frames[-1]
+        stats["skipped"] += sequence - last_taken - 1
+        stats["decoded"] += 1
+        last_taken = sequence
+        return img
+
+def start_capture(source="0"):
+    global cap, decoders, capture_thread, capturing, last_taken, frame_interval
+    if cap is None:
+        cap = open_source(source) # setup variables for capturing the video and decting the qr code
+        live = source == "" or source.isdigit()
+        fps = 0 if live else (cap.get(cv2.CAP_PROP_FPS) or 30)
+        frame_interval = 1 / fps if fps else 0
+    if decoders is None:
+        decoders = DecodePool(DECODE_WORKERS)
+    if capture_thread is None:
+        frames.clear()
+        last_taken = 0
+        stats.update(captured=0, decoded=0, skipped=0)
+        capturing = True
+        capture_thread = threading.Thread(target=capture_loop, daemon=True)
+        capture_thread.start()
+        decoders.start(take_latest)
+
+def stop_scan(): # make func() return None once the frames being decoded are done; called from another thread
+    global capturing
+    with frame_ready:
+        capturing = False
+        frame_ready.notify_all()
+
+def stop_capture():
+    global cap, capture_thread, capturing
+    if capture_thread is not None:
+        with frame_ready:
+            capturing = False
+            frame_ready.notify_all()
+        capture_thread.join()
+        capture_thread = None
+        decoders.stop()
+        tracking = decoders.tracking()
+        print("Camera: %d frames captured, %d decoded, %d skipped; %d codes located in %d searches, %d tracked, %d duplicates merged" %
+              (stats["captured"], stats["decoded"], stats["skipped"], tracking["located"], tracking["searches"],
+               tracking["tracked"], decoders.stats["duplicates"]))
+    if cap is not None:
+        cap.release() #stop the video capturing
+        cap = None
+    cv2.destroyAllWindows() #close down window
 
 def func():
-    cap = cv2.VideoCapture(0) # setup variables for capturing the video and decting the qr code
-    detector = cv2.QRCodeDetector()
+    start_capture()
 
     print("Reading QR code using Raspberry Pi camera")
 
     while True: # loop until a QR code is found or process is cancelled by user
 
-        _, img = cap.read() # video capturing from webcam and displaying the read qr code 
-        data, bbox, _ = detector.detectAndDecode(img) # qr code detection 
+        result = decoders.collect() # the frames the decode workers have finished, in order
+        if result is None: # the capture stopped, or stop_scan() was called
+            break
+        img, data, bboxes = result # qr code detection 
             
-        if bbox is not None: # if the box is being displayed
+        for code, bbox in zip(data, bboxes): # if the box is being displayed
             
             for i in range(len(bbox)): # parse through pixel boxes
-                cv2.line(img, tuple(bbox[i][0]), tuple(bbox[(i+1) % len(bbox)][0]), color=(255,0, 0), thickness=2)
-                cv2.putText(img, data, (int(bbox[0][0][0]), int(bbox[0][0][1]) - 10), cv2.FONT_HERSHEY_SIMPLEX,0.5, (0, 255, 0), 2)
+                cv2.line(img, tuple(map(int, bbox[i])), tuple(map(int, bbox[(i+1) % len(bbox)])), color=(255,0, 0), thickness=2)
+                cv2.putText(img, code, (int(bbox[0][0]), int(bbox[0][1]) - 10), cv2.FONT_HERSHEY_SIMPLEX,0.5, (0, 255, 0), 2)
                 
-            if data:
-                print("Data found: " + data) # print if the data has been detected
-                cap.release() #stop the video capturing
-                cv2.destroyAllWindows() #close down window
-                new = ""
-                new = data # create new variable for returning
-                return(new)
+        if data:
+            print("Data found: " + ", ".join(data)) # print if the data has been detected
+            return data # every code read, in the order the frames were captured
                 
         cv2.imshow("code detector", img) # display on box that code has been detected
 
@@ -33,4 +336,49 @@ def func():
             break
 
     
-func()
+def replay_pass(source, multi, workers): # decode every frame of a recording as fast as possible, and report the throughput
+    source_cap = open_source(source)
+    def read():
+        ok, img = source_cap.read()
+        return img if ok else None
+    pool = DecodePool(workers, multi)
+    merged = 0
+    start = time.perf_counter()
+    pool.start(read)
+    while True:
+        result = pool.collect()
+        if result is None:
+            break
+        merged += len(result[1])
+    pool.stop()
+    seconds = time.perf_counter() - start
+    source_cap.release()
+    frames, busy = pool.stats["frames"], pool.stats["busy"]
+    per_frame = 1000 * busy / frames if frames else 0
+    rate = frames / seconds if seconds else 0 # frames decoded per second of wall-clock time; busy time only gives the cost of a decode
+    tracking = pool.tracking()
+    print("Replay of %s, %s per frame, %d %s: %d frames in %.3f s, %.1f decodes/s (%.2f ms per decode), "
+          "%d frames with a code, %d codes, %d once merged (%d located in %d searches, %d tracked)" %
+          (source, "every code" if multi else "one code", workers, "worker" if workers == 1 else "workers", frames, seconds,
+           rate, per_frame, pool.stats["with_code"], pool.stats["codes"], merged,
+           tracking["located"], tracking["searches"], tracking["tracked"]))
+    return frames, per_frame, rate
+
+def replay(source): # replay reading one code per frame, then every code with 1 to REPLAY_WORKERS workers, and compare them
+    frames, single, _ = replay_pass(source, False, 1)
+    if frames:
+        results = [replay_pass(source, True, workers) for workers in range(1, REPLAY_WORKERS + 1)]
+        multi = results[0][1]
+        rates = [rate for _, _, rate in results]
+        print("Reading every code costs %.2f ms per frame more than reading one (%.0f%%)" %
+              (multi - single, 100 * (multi - single) / single if single else 0))
+        print("Decodes/s with 1 to %d workers: %s (%.2fx with %d)" %
+              (len(rates), " ".join("%.1f" % rate for rate in rates), rates[-1] / rates[0] if rates[0] else 0, len(rates)))
+    return frames
+
+if __name__ == "__main__": # run a single scan when started on its own, but not when imported by Camera.cpp
+    if len(sys.argv) == 3 and sys.argv[1] == "--replay":
+        replay(sys.argv[2])
+    else:
+        print(func())
+        stop_capture()
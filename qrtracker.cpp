@@ -0,0 +1,219 @@
+/**
+ * QRTracker class. Running cv::QRCodeDetector over every full-resolution frame costs
+ * the same whether or not a code is in view, and most frames hold none. So each frame is
+ * first searched on a grayscale copy scaled down to QR_DETECT_WIDTH pixels wide, which is
+ * cheap; only the region around each code found there, widened by QR_REGION_MARGIN of its
+ * size on each side, is decoded at full resolution. The regions of the codes decoded are
+ * handed back (see decodedRegions()), and since passes held up to the camera barely move
+ * between frames, the next frame is decoded there straight away, without searching; the
+ * search runs again when that fails. The caller passes the regions in, so that trackers
+ * decoding frames on several threads can all start from the latest frame any of them
+ * decoded (see DecodePool). With QR_MULTI_CODE, every code in the frame is decoded, so a group holding up
+ * their passes together is let through from a single frame.
+ * @brief Finds QR codes on downscaled frames and decodes them in their regions.
+ * @author Liam Garrett
+ */
+
+#include "config.h"
+
+#if defined(USING_CAMERA) && defined(USING_NATIVE_CAMERA)
+
+#include "qrtracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+/**
+ * Constructor
+ * @brief Creates a tracker that hasn't seen a code yet.
+ * @param multi    Whether to decode every code in a frame (see QR_MULTI_CODE), or just one.
+*/
+QRTracker::QRTracker(bool multi){
+	this->multi = multi;
+	reset();
+}
+
+/**
+ * Decodes the codes seen in an earlier frame in their regions first. If one of them is
+ * gone, or none was seen, the frame is searched. With several codes, the frame is also
+ * searched once every QR_SEARCH_INTERVAL frames while all of them are still in place,
+ * so that a code coming into view next to them is picked up too.
+ * @brief Finds and decodes the QR codes in a frame.
+ * @param frame    The camera frame, in color or grayscale.
+ * @param seen     Where codes were decoded in the latest frame decoded before this one,
+ *                 usually decodedRegions() after it; must not be that very vector.
+ * @param data     Set to the payload of every code decoded, each payload once.
+ * @return The number of codes decoded.
+*/
+std::size_t QRTracker::decode(const cv::Mat &frame, const std::vector<cv::Rect> &seen, std::vector<std::string> &data){
+	counts.frames++;
+	data.clear();
+	if(frame.channels() == 3)
+		cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+	const cv::Mat &image = frame.channels() == 3 ? gray : frame;
+
+	regions.clear();
+	bool lost = seen.empty();
+	for(const cv::Rect &area : seen){
+		if(decodeRegion(image, area, data))
+			counts.tracked++;
+		else
+			lost = true; // the code moved out of its region, or out of view
+	}
+
+	if(lost || (multi && ++sinceSearch >= QR_SEARCH_INTERVAL))
+		search(image, data);
+	return data.size();
+}
+
+/**
+ * @brief Returns where codes were decoded in the last frame.
+ * @return The regions of the codes decoded by the last call to decode(), in full-resolution pixels.
+*/
+const std::vector<cv::Rect>& QRTracker::decodedRegions() const{
+	return regions;
+}
+
+/**
+ * Called at the start of each session, as the last codes seen are long gone by then.
+ * @brief Forgets the regions of the last codes and clears the counters.
+*/
+void QRTracker::reset(){
+	regions.clear();
+	sinceSearch = 0;
+	counts = QRTrackerStats();
+}
+
+/**
+ * @brief Returns the tracker's counters.
+ * @return How many frames were decoded and searched, and how many codes were located or tracked.
+*/
+QRTrackerStats QRTracker::stats() const{
+	return counts;
+}
+
+/**
+ * Looks for a code on the frame scaled down to QR_DETECT_WIDTH, and decodes it in its
+ * region at full resolution. When every code is wanted, each code found, and each one
+ * already decoded in this frame, is painted over on the downscaled frame and the search
+ * is repeated, until no more codes turn up or QR_MAX_CODES have been read.
+ * OpenCV's multi-code detector is not used for this: on frames scaled down enough to be
+ * cheap to search, it finds only some of the codes a repeated single search finds.
+ * @brief Searches a frame for codes that aren't tracked yet.
+ * @param image    The frame, in grayscale.
+ * @param data     The payloads decoded so far in this frame, to which new ones are added.
+*/
+void QRTracker::search(const cv::Mat &image, std::vector<std::string> &data){
+	counts.searches++;
+	sinceSearch = 0;
+
+	double scale = 1;
+	const cv::Mat *searched = &image;
+	if(QR_DETECT_WIDTH > 0 && image.cols > QR_DETECT_WIDTH){
+		scale = double(QR_DETECT_WIDTH) / image.cols;
+		cv::resize(image, small, cv::Size(), scale, scale, cv::INTER_AREA);
+		searched = &small;
+	}else if(multi){
+		image.copyTo(small); // to be painted over
+		searched = &small;
+	}
+	if(multi){
+		for(const cv::Rect &region : regions)
+			hide(region, scale);
+	}
+
+	for(int round = 0; round < (multi ? QR_MAX_CODES : 1) && data.size() < QR_MAX_CODES; round++){
+		std::vector<cv::Point2f> corners;
+		if(!detector.detect(*searched, corners))
+			return;
+		for(cv::Point2f &corner : corners)
+			corner /= scale;
+		cv::Rect area = bound(corners, image.size());
+		if(plausible(corners) && decodeRegion(image, area, data))
+			counts.located++;
+		if(multi)
+			hide(area, scale);
+	}
+}
+
+/**
+ * Paints the code in a region over on the downscaled frame, so that the next search
+ * finds another one. The margin of the region is left alone, as it may hold part of
+ * a code right next to this one.
+ * @brief Hides a code from the search.
+ * @param area     The code's region, in full-resolution pixels.
+ * @param scale    The scale of the downscaled frame.
+*/
+void QRTracker::hide(const cv::Rect &area, double scale){
+	double inset = QR_REGION_MARGIN / (1 + 2 * QR_REGION_MARGIN);
+	cv::Rect code(cv::Point(int((area.x + area.width * inset) * scale), int((area.y + area.height * inset) * scale)),
+	              cv::Point(int((area.br().x - area.width * inset) * scale) + 1, int((area.br().y - area.height * inset) * scale) + 1));
+	code &= cv::Rect(cv::Point(0, 0), small.size());
+	if(!code.empty())
+		small(code).setTo(cv::Scalar(128));
+}
+
+/**
+ * Decodes the given part of a grayscale frame at full resolution. If a new code is read,
+ * its region becomes one the next frame is decoded in, so the region follows the code
+ * as it moves.
+ * @brief Decodes a code in one region of the frame.
+ * @param image   The frame, in grayscale.
+ * @param area    The region, in full-resolution pixels.
+ * @param data    The payloads decoded so far in this frame, to which the code's is added.
+ * @return true if a code not decoded yet in this frame was decoded, false otherwise.
+*/
+bool QRTracker::decodeRegion(const cv::Mat &image, cv::Rect area, std::vector<std::string> &data){
+	std::vector<cv::Point2f> corners;
+	std::string found = detector.detectAndDecode(image(area), corners);
+	if(found.empty() || corners.empty() || std::find(data.begin(), data.end(), found) != data.end())
+		return false;
+	for(cv::Point2f &corner : corners)
+		corner += cv::Point2f(area.x, area.y);
+	regions.push_back(bound(corners, image.size()));
+	data.push_back(found);
+	return true;
+}
+
+/**
+ * The detector sometimes finds a code in texture or noise. Its corners are then
+ * rarely shaped like a code, which seen at an angle is still a convex quad with sides
+ * of similar length, and skipping those saves decoding a large region for nothing.
+ * @brief Tells whether the corners found by the detector could be a code.
+ * @param corners    The corners found.
+ * @return true if they are worth decoding.
+*/
+bool QRTracker::plausible(const std::vector<cv::Point2f> &corners){
+	if(corners.size() != 4 || !cv::isContourConvex(corners))
+		return false;
+	double shortest = INFINITY, longest = 0;
+	for(std::size_t i = 0; i < corners.size(); i++){
+		double side = cv::norm(corners[i] - corners[(i + 1) % corners.size()]);
+		shortest = std::min(shortest, side);
+		longest = std::max(longest, side);
+	}
+	return shortest * 2 >= longest;
+}
+
+/**
+ * @brief Returns the box around a code's corners, widened by QR_REGION_MARGIN and kept inside the frame.
+ * @param corners    The code's corners, in full-resolution pixels.
+ * @param size       The size of the frame.
+ * @return The region to decode the code in.
+*/
+cv::Rect QRTracker::bound(const std::vector<cv::Point2f> &corners, cv::Size size){
+	float left = INFINITY, top = INFINITY, right = -INFINITY, bottom = -INFINITY;
+	for(const cv::Point2f &corner : corners){
+		left = std::min(left, corner.x);
+		top = std::min(top, corner.y);
+		right = std::max(right, corner.x);
+		bottom = std::max(bottom, corner.y);
+	}
+	double marginX = (right - left) * QR_REGION_MARGIN, marginY = (bottom - top) * QR_REGION_MARGIN;
+	cv::Rect box(cv::Point(int(left - marginX), int(top - marginY)),
+	             cv::Point(int(right + marginX) + 1, int(bottom + marginY) + 1));
+	return box & cv::Rect(cv::Point(0, 0), size);
+}
+
+#endif
@@ -0,0 +1,51 @@
+/**
+ * Header for the QRTracker class, which finds and decodes the QR codes in camera frames
+ * for the native camera backend while doing as little work per frame as it can.
+ * Only used with USING_NATIVE_CAMERA.
+ * @brief The header file for the qrtracker class.
+ * @author Liam Garrett
+ */
+
+#ifndef QRTRACKER_H
+#define QRTRACKER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+// Counters describing a QRTracker, see QRTracker::stats()
+struct QRTrackerStats {
+	std::uint64_t frames;   // frames decoded
+	std::uint64_t searches; // frames searched for codes on the downscaled frame
+	std::uint64_t located;  // codes decoded after being found by a search
+	std::uint64_t tracked;  // codes decoded straight from their region in the frame before
+};
+
+class QRTracker{
+	public:
+		explicit QRTracker(bool multi);
+
+		std::size_t decode(const cv::Mat &frame, const std::vector<cv::Rect> &seen, std::vector<std::string> &data);
+		const std::vector<cv::Rect>& decodedRegions() const;
+		void reset();
+		QRTrackerStats stats() const;
+
+	private:
+		cv::QRCodeDetector detector;
+		bool multi; // Every code in a frame is decoded, rather than just one
+		unsigned sinceSearch; // Frames decoded from tracked regions alone since the last search
+		cv::Mat gray; // A color frame converted to grayscale, reused between frames
+		cv::Mat small; // The grayscale frame scaled down to QR_DETECT_WIDTH for searching, reused between frames
+		std::vector<cv::Rect> regions; // Where codes were decoded in the frame given to decode() last, in full-resolution pixels
+		QRTrackerStats counts;
+
+		void search(const cv::Mat &image, std::vector<std::string> &data);
+		bool decodeRegion(const cv::Mat &image, cv::Rect area, std::vector<std::string> &data);
+		void hide(const cv::Rect &area, double scale);
+		static bool plausible(const std::vector<cv::Point2f> &corners);
+		static cv::Rect bound(const std::vector<cv::Point2f> &corners, cv::Size size);
+};
+
+#endif
@@ -7,22 +7,64 @@
  */
 
 #include "record.h"
+#include "namepool.h"
+#include <ctime>
+#include <limits>
+#include <charconv>
+#include <cstring>
+#include <unordered_map>
 
 /**
  * Constructor
  * The constructor for when all attributes of a record are known on creation.
+ * Records are kept compact: a numeric id is stored as a number, the date as a day number,
+ * and the names as pointers into the shared NamePool, so a record never owns a string of
+ * its own. Ids and dates that cannot be converted without changing their text are pooled
+ * as text instead.
  * @brief Constructor for a record object.
  * @param id The string representation of a user's ID. It is unique to them.
  * @param first The user's first name.
  * @param last The user's last name.
  * @param vaxDate The date the user received their second vaccine dose.
  * */
-Record::Record(std::string id, std::string first, std::string last, std::string vaxDate){
+Record::Record(std::string_view id, std::string_view first, std::string_view last, std::string_view vaxDate){
     
-    vaxId = id;
+    setId(id);
+    setfName(first);
+    setlName(last);
+    setDate(vaxDate);
+
+}
+
+/**
+ * Constructor
+ * The constructor for a record whose fields are already in their stored form, such as the
+ * entries of a binary snapshot, so that no text has to be formatted, parsed or interned again.
+ * Every string must come from the NamePool.
+ * @brief Constructor for a record object from its stored fields.
+ * @param id The numeric id, when idText is nullptr; it must be one parseNumericId() can return.
+ * @param idText The pooled id when it is not numeric, otherwise nullptr.
+ * @param first The pooled first name.
+ * @param last The pooled last name.
+ * @param vaxDay The date as days since 1970.01.01, when dateText is nullptr.
+ * @param vaxDateText The pooled date when it is not a valid YYYY.MM.DD date, otherwise nullptr.
+ * */
+Record::Record(std::uint64_t id, const std::string *idText, const std::string *first, const std::string *last,
+               std::int32_t vaxDay, const std::string *vaxDateText){
+
+    this->idValue = idText != nullptr ? 0 : id;
+    this->idText = idText;
     fName = first;
     lName = last;
-    date = vaxDate;
+    if(vaxDateText == nullptr){
+        day = vaxDay;
+        dateText = nullptr;
+        eligibleAt = localMidnight(day) + ELIGIBILITY_DELAY;
+    }else{
+        day = 0;
+        dateText = vaxDateText;
+        eligibleAt = std::numeric_limits<std::int64_t>::max();
+    }
 
 }
 
@@ -30,7 +72,7 @@ Record::Record(std::string id, std::string first, std::string last, std::string
  * Constructor
  * The constructor that is called when no attributes about the record are known
  * */
-Record::Record(){
+Record::Record() : Record("", "", "", ""){
     
 }
 
@@ -39,8 +81,13 @@ Record::Record(){
  * @brief ID mutator method.
  * @param id The new ID of the record.
  */
-void Record::setId(std::string id){
-    vaxId = id;
+void Record::setId(std::string_view id){
+    if(parseNumericId(id, idValue)){
+        idText = nullptr;
+    }else{
+        idValue = 0;
+        idText = NamePool::instance().intern(id);
+    }
 }
 
 /**
@@ -48,8 +95,8 @@ void Record::setId(std::string id){
  * @brief fName mutator method.
  * @param first The new fName of the record.
  */
-void Record::setfName(std::string first){
-    fName = first;
+void Record::setfName(std::string_view first){
+    fName = NamePool::instance().intern(first);
 }
 
 /**
@@ -57,26 +104,42 @@ void Record::setfName(std::string first){
  * @brief lName mutator method.
  * @param last The new lName of the record.
  * */
-void Record::setlName(std::string last){
-    lName = last;
+void Record::setlName(std::string_view last){
+    lName = NamePool::instance().intern(last);
 }
 
 /**
  * Sets the date of the second dose acqusition for the record.
+ * The moment the user becomes eligible for entry (local midnight on that date, plus
+ * ELIGIBILITY_DELAY) is worked out here, so checking it later is a single comparison.
+ * A date that is not a valid YYYY.MM.DD date never becomes eligible.
  * @brief date mutator method.
  * @param vaxDate The new date of the record.
  * */
-void Record::setDate(std::string vaxDate){
-    date = vaxDate;
+void Record::setDate(std::string_view vaxDate){
+    if(parseDay(vaxDate, day)){
+        dateText = nullptr;
+        eligibleAt = localMidnight(day) + ELIGIBILITY_DELAY;
+    }else{
+        day = 0;
+        dateText = NamePool::instance().intern(vaxDate);
+        eligibleAt = std::numeric_limits<std::int64_t>::max();
+    }
 }
 
 /** 
  * Returns the id of the record.
+ * A text id is returned as its pooled string, and a numeric id is formatted back into text
+ * inside the returned object, so no memory is allocated either way.
  * @brief ID accessor method.
  * @return The id of the record.
  */
-std::string Record::getId() const{
-    return vaxId;
+FieldText Record::getId() const{
+    if(idText != nullptr){
+        return FieldText(*idText);
+    }
+    char digits[20];
+    return FieldText(digits, std::to_chars(digits, digits + sizeof(digits), idValue).ptr - digits);
 }
 
 /**
@@ -84,8 +147,8 @@ std::string Record::getId() const{
  * @brief fName accessor method.
  * @return The fName of the record.
  */
-std::string Record::getfName() const{
-    return fName;
+const std::string& Record::getfName() const{
+    return *fName;
 }
 
 /**
@@ -93,29 +156,89 @@ std::string Record::getfName() const{
  * @brief lName accessor method.
  * @return The lName of the record.
  * */
-std::string Record::getlName() const{
-    return lName;
+const std::string& Record::getlName() const{
+    return *lName;
 }
 
 /**
  * Returns the second dose date of the record.
+ * The date is formatted back into YYYY.MM.DD inside the returned object, or returned as its
+ * pooled string when it is not a valid date, so no memory is allocated.
  * @brief date accessor method.
  * @return The date of the record.
  * */
-std::string Record::getDate() const{
-    return date;
+FieldText Record::getDate() const{
+    if(dateText != nullptr){
+        return FieldText(*dateText);
+    }
+    char text[10];
+    writeDay(day, text);
+    return FieldText(text, sizeof(text));
+}
+
+/**
+ * Returns a number that identifies the record's id: the id itself when it is numeric,
+ * otherwise a value derived from its pooled text. Two records have the same key exactly
+ * when they have the same id, so it can stand in for the id in hash tables.
+ * @brief Returns the record's id as a 64-bit key.
+ * @return The key of the record's id.
+ * */
+std::uint64_t Record::getKey() const{
+    return idText != nullptr ? textKey(idText) : idValue;
+}
+
+/**
+ * @brief Returns the record's first name as a 64-bit key (see getKey()).
+ * @return The key of the record's first name.
+ * */
+std::uint64_t Record::getfNameKey() const{
+    return textKey(fName);
+}
+
+/**
+ * @brief Returns the record's last name as a 64-bit key (see getKey()).
+ * @return The key of the record's last name.
+ * */
+std::uint64_t Record::getlNameKey() const{
+    return textKey(lName);
+}
+
+/**
+ * @brief Returns the record's date as a 64-bit key (see getKey()).
+ * @return The key of the record's date.
+ * */
+std::uint64_t Record::getDateKey() const{
+    return dateText != nullptr ? textKey(dateText) : static_cast<std::uint32_t>(day);
+}
+
+/**
+ * @brief Returns when the user may first be admitted (see setDate()).
+ * @return The time the user becomes eligible, in seconds since the epoch.
+ * */
+std::int64_t Record::getEligibleAt() const{
+    return eligibleAt;
+}
+
+/**
+ * @brief Checks whether ELIGIBILITY_DELAY has passed since the user's second dose.
+ * @param now The current time, in seconds since the epoch (e.g. from std::time()).
+ * @return true if the user may be admitted at that time.
+ * */
+bool Record::isEligible(std::int64_t now) const{
+    return now >= eligibleAt;
 }
 
 /**
  * Overrides the == operator to function with record objects.
  * It will check if two records (this record and another passed into it) are identical by all four variables: id, fName, lName, and date.
+ * Pooled strings are equal exactly when their pointers are, so no characters are compared.
  * @brief Overrides == so it works on record objects.
  * @param other The other record to be compared against.
  * @return True if the records are the same, false otherwise.
  * */
 bool Record::operator==(const Record& other) const{
-	return (this->getId() == other.getId() && this->getfName() == other.getfName() &&
-		    this->getlName() == other.getlName() && this->getDate() == other.getDate());
+	return (idValue == other.idValue && idText == other.idText && fName == other.fName &&
+		    lName == other.lName && day == other.day && dateText == other.dateText);
 }
 
 /**
@@ -128,3 +251,223 @@ bool Record::operator==(const Record& other) const{
 bool Record::operator!=(const Record& other) const{
 	return !(*this == other);
 }
+
+/**
+ * Computes the key (see getKey()) that a record with the given id would have.
+ * @brief Converts an id to a 64-bit key.
+ * @param id The id.
+ * @param key Receives the key of the id.
+ * @return true if the key was computed, false if no record can have this id.
+ * */
+bool Record::idKey(std::string_view id, std::uint64_t& key){
+    if(parseNumericId(id, key)){
+        return true;
+    }
+    const std::string *text = NamePool::instance().find(id);
+    key = textKey(text);
+    return text != nullptr;
+}
+
+/**
+ * Computes the key that a record with the given first or last name would have.
+ * @brief Converts a name to a 64-bit key.
+ * @param name The name.
+ * @param key Receives the key of the name.
+ * @return true if the key was computed, false if no record can have this name.
+ * */
+bool Record::nameKey(std::string_view name, std::uint64_t& key){
+    const std::string *text = NamePool::instance().find(name);
+    key = textKey(text);
+    return text != nullptr;
+}
+
+/**
+ * Computes the key that a record with the given date would have.
+ * @brief Converts a date to a 64-bit key.
+ * @param date The date.
+ * @param key Receives the key of the date.
+ * @return true if the key was computed, false if no record can have this date.
+ * */
+bool Record::dateKey(std::string_view date, std::uint64_t& key){
+    std::int32_t day;
+    if(parseDay(date, day)){
+        key = static_cast<std::uint32_t>(day);
+        return true;
+    }
+    const std::string *text = NamePool::instance().find(date);
+    key = textKey(text);
+    return text != nullptr;
+}
+
+/**
+ * The same few hundred dates are shared by every record, so each thread remembers the
+ * answers it has already worked out rather than calling mktime for every record.
+ * @brief Returns the start of a day in the local time zone.
+ * @param day The number of days since 1970.01.01.
+ * @return Local midnight at the start of that day, in seconds since the epoch.
+ * */
+std::int64_t Record::localMidnight(std::int32_t day){
+
+    thread_local std::unordered_map<std::int32_t, std::int64_t> known;
+    auto it = known.find(day);
+    if(it != known.end()){
+        return it->second;
+    }
+
+    std::string date = formatDay(day);
+    std::tm givenTime = std::tm();
+    givenTime.tm_year = std::stoi(date.substr(0, 4)) - 1900;
+    givenTime.tm_mon = std::stoi(date.substr(5, 2)) - 1;
+    givenTime.tm_mday = std::stoi(date.substr(8, 2));
+    givenTime.tm_isdst = -1;    // let mktime work out whether daylight saving time applies
+
+    std::int64_t midnight = std::mktime(&givenTime);
+    known.emplace(day, midnight);
+    return midnight;
+}
+
+/**
+ * Numeric ids are below 2^63 and day numbers below 2^32, so setting the top bit keeps the
+ * key of a pooled string apart from both.
+ * Pooled strings are aligned in memory, so the lowest bit of such a key is always clear.
+ * @brief Converts a pooled string to a 64-bit key.
+ * @param text The pooled string.
+ * @return The key of the string.
+ * */
+std::uint64_t Record::textKey(const std::string *text){
+    return (1ULL << 63) | reinterpret_cast<std::uintptr_t>(text);
+}
+
+/**
+ * Ids are normally student numbers. An id made only of digits, without a leading zero and
+ * short enough to fit comfortably in 64 bits, can be stored as a number and turned back
+ * into exactly the same text; any other id has to be kept as text.
+ * @brief Converts an id to a number when that loses nothing.
+ * @param id The id to convert.
+ * @param value Receives the numeric value of the id.
+ * @return true if the id is numeric, false otherwise.
+ * */
+bool Record::parseNumericId(std::string_view id, std::uint64_t& value){
+
+    if(id.empty() || id.size() > 18 || (id[0] == '0' && id.size() > 1)){
+        return false;
+    }
+    value = 0;
+    for(char c : id){
+        if(c < '0' || c > '9'){
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+/**
+ * Converts a YYYY.MM.DD date to the number of days since 1970.01.01.
+ * Only dates that format back to exactly the same text are accepted.
+ * @brief Converts a date to a day number.
+ * @param date The date to convert.
+ * @param day Receives the day number of the date.
+ * @return true if the date is a valid YYYY.MM.DD date, false otherwise.
+ * */
+bool Record::parseDay(std::string_view date, std::int32_t& day){
+
+    if(date.size() != 10 || date[4] != '.' || date[7] != '.'){
+        return false;
+    }
+    for(int i : {0, 1, 2, 3, 5, 6, 8, 9}){
+        if(date[i] < '0' || date[i] > '9'){
+            return false;
+        }
+    }
+
+    int y = (date[0] - '0') * 1000 + (date[1] - '0') * 100 + (date[2] - '0') * 10 + (date[3] - '0');
+    unsigned m = (date[5] - '0') * 10 + (date[6] - '0');
+    unsigned d = (date[8] - '0') * 10 + (date[9] - '0');
+
+    // days from civil date (proleptic Gregorian calendar), with the year starting in March
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    day = era * 146097 + static_cast<int>(doe) - 719468;
+
+    return formatDay(day) == date;
+}
+
+/**
+ * @brief Converts a day number back to a YYYY.MM.DD date.
+ * @param day The number of days since 1970.01.01.
+ * @return The date as YYYY.MM.DD.
+ * */
+std::string Record::formatDay(std::int32_t day){
+    char text[10];
+    writeDay(day, text);
+    return std::string(text, sizeof(text));
+}
+
+/**
+ * @brief Writes a day number as a YYYY.MM.DD date.
+ * @param day The number of days since 1970.01.01.
+ * @param text Receives the ten characters of the date.
+ * */
+void Record::writeDay(std::int32_t day, char (&text)[10]){
+
+    // civil date from days (proleptic Gregorian calendar), with the year starting in March
+    int z = day + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = static_cast<unsigned>(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int y = static_cast<int>(yoe) + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    y += m <= 2;
+
+    const char digits[10] = {
+        static_cast<char>('0' + y / 1000 % 10), static_cast<char>('0' + y / 100 % 10),
+        static_cast<char>('0' + y / 10 % 10), static_cast<char>('0' + y % 10), '.',
+        static_cast<char>('0' + m / 10), static_cast<char>('0' + m % 10), '.',
+        static_cast<char>('0' + d / 10), static_cast<char>('0' + d % 10)
+    };
+    memcpy(text, digits, sizeof(digits));
+}
+
+/**
+ * Constructor
+ * @brief Creates the text of a field from its pooled string, which is referred to rather than copied.
+ * @param text The pooled string; it must outlive this object.
+ * */
+FieldText::FieldText(const std::string& text){
+    pooled = &text;
+    length = 0;
+}
+
+/**
+ * Constructor
+ * @brief Creates the text of a field by copying it into the object.
+ * @param text The characters of the field.
+ * @param size The number of characters, at most CAPACITY.
+ * */
+FieldText::FieldText(const char *text, std::size_t size){
+    pooled = nullptr;
+    length = static_cast<std::uint8_t>(size < CAPACITY ? size : CAPACITY);
+    memcpy(buffer, text, length);
+}
+
+/**
+ * @brief Returns the text.
+ * @return A view of the text, valid for as long as this object.
+ * */
+std::string_view FieldText::view() const{
+    return pooled != nullptr ? std::string_view(*pooled) : std::string_view(buffer, length);
+}
+
+/**
+ * @brief Reads the text as a std::string_view (see view()).
+ * */
+FieldText::operator std::string_view() const{
+    return view();
+}
@@ -8,30 +8,78 @@
 #define RECORD_H
 
 #include <string>
+#include <string_view>
+#include <cstdint>
+
+// The text of a record field that is not kept as a string (see Record::getId() and
+// Record::getDate()). It refers to the pooled string, or holds the formatted number itself,
+// so it can be handed out without allocating; it reads as a std::string_view, valid while it lives.
+class FieldText {
+
+    public:
+        explicit FieldText(const std::string&);
+        FieldText(const char*, std::size_t);
+
+        std::string_view view() const;
+        operator std::string_view() const;
+
+    private:
+        static const std::size_t CAPACITY = 20;  // digits of the largest 64-bit number
+
+        const std::string *pooled;  // the pooled text, or nullptr when it is held in buffer
+        char buffer[CAPACITY];
+        std::uint8_t length;
+
+};
 
 class Record {
 
     public:
-        Record(std::string, std::string, std::string, std::string);
+        static const std::int64_t ELIGIBILITY_DELAY = 14 * 24 * 60 * 60;  // seconds from the second dose until a user is admitted
+
+        Record(std::string_view, std::string_view, std::string_view, std::string_view);
+        Record(std::uint64_t, const std::string*, const std::string*, const std::string*, std::int32_t, const std::string*);
         Record();
-        std::string getId() const;
-        std::string getfName() const;
-        std::string getlName() const;
-        std::string getDate() const;
+        FieldText getId() const;
+        const std::string& getfName() const;
+        const std::string& getlName() const;
+        FieldText getDate() const;
+
+        void setId(std::string_view);
+        void setfName(std::string_view);
+        void setlName(std::string_view);
+        void setDate(std::string_view);
 
-        void setId(std::string);
-        void setfName(std::string);
-        void setlName(std::string);
-        void setDate(std::string);
+        std::uint64_t getKey() const;
+        std::uint64_t getfNameKey() const;
+        std::uint64_t getlNameKey() const;
+        std::uint64_t getDateKey() const;
+        std::int64_t getEligibleAt() const;
+        bool isEligible(std::int64_t now) const;
 
 	bool operator==(const Record& other) const;
 	bool operator!=(const Record& other) const;
 
+        static bool idKey(std::string_view, std::uint64_t&);
+        static bool nameKey(std::string_view, std::uint64_t&);
+        static bool dateKey(std::string_view, std::uint64_t&);
+
+        static bool parseNumericId(std::string_view, std::uint64_t&);
+        static bool parseDay(std::string_view, std::int32_t&);
+        static std::string formatDay(std::int32_t);
+
     private:
-        std::string vaxId;
-        std::string fName;
-        std::string lName;
-        std::string date;
+        std::uint64_t idValue;          // the id, when it is numeric
+        std::int64_t eligibleAt;        // when the user may first be admitted, in seconds since the epoch
+        const std::string *idText;      // the pooled id when it is not numeric, otherwise nullptr
+        const std::string *fName;       // pooled first name
+        const std::string *lName;       // pooled last name
+        const std::string *dateText;    // the pooled date when it is not a valid YYYY.MM.DD date, otherwise nullptr
+        std::int32_t day;               // the date as days since 1970.01.01
+
+        static std::uint64_t textKey(const std::string *text);
+        static std::int64_t localMidnight(std::int32_t day);
+        static void writeDay(std::int32_t day, char (&text)[10]);
 
 };
 #endif
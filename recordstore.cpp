@@ -0,0 +1,441 @@
+/**
+ * The indexed record container behind the database.
+ * Records are kept in a vector, with a hash index from id to slot plus one index per
+ * searchable field (first name, last name, date) mapping a value to every slot holding it.
+ * The vectors and indexes are shared between copies of a store until one of them changes
+ * (see SharedVector and SharedMap), so copying a store to change it, as the database does for
+ * every edit, costs about as much as the change rather than the whole store.
+ * Every index is keyed by the 64-bit field keys of Record, so no strings are hashed or
+ * compared once a record is in the store. A bloom filter over the ids turns away ids the store
+ * does not hold (e.g. a foreign QR code) before any of the indexes is consulted.
+ * Ids are unique keys, so a store can never hold two records with the same id.
+ * @brief A record vector with hash indexes on every field.
+ * @author Justin Teichman
+ * */
+#include <recordstore.h>
+#include <algorithm>
+#include <thread>
+
+// Defined here as well, since std::max takes it by reference
+const std::size_t RecordStore::MIN_FILTER_CAPACITY;
+
+/**
+ * Adds a record into the store and all of its indexes.
+ * @brief Inserts a record.
+ * @param rec The record to insert.
+ * @return true if the record was inserted, false if its id is already in use.
+ * */
+bool RecordStore::insert(const Record& rec){
+
+    if(idIndex.find(rec.getKey()) != nullptr){
+        return false;
+    }
+    recs.push_back(rec);
+    indexSlot(recs.size()-1);
+    filterId(rec);
+    return true;
+}
+
+/**
+ * Removes the record with the given id from the store.
+ * The last record is moved into the freed slot, so removal does not shift the rest of the vector.
+ * @brief Removes a record by id.
+ * @param id The id of the record to remove.
+ * @return true if a record was removed, false if no record has that id.
+ * */
+bool RecordStore::remove(std::string_view id){
+
+    Key key;
+    if(!Record::idKey(id, key)){
+        return false;
+    }
+    const Slot *found = idIndex.find(key);
+    if(found == nullptr){
+        return false;
+    }
+
+    Slot slot = *found;
+    Slot last = recs.size()-1;
+    unindexSlot(slot);
+    if(slot != last){
+        unindexSlot(last);
+        Record moved = recs.at(last);
+        recs.edit(slot) = moved;
+        indexSlot(slot);
+    }
+    recs.pop_back();
+    places.pop_back();
+    return true;
+}
+
+/**
+ * Replaces the record with the given id by a new record, which keeps the same slot.
+ * The new record may carry a different id, as long as no other record uses it.
+ * @brief Replaces a record by id.
+ * @param id The id of the record to replace.
+ * @param rec The record that takes its place.
+ * @return true if the record was replaced, false otherwise.
+ * */
+bool RecordStore::replace(std::string_view id, const Record& rec){
+
+    Key key;
+    if(!Record::idKey(id, key)){
+        return false;
+    }
+    const Slot *found = idIndex.find(key);
+    if(found == nullptr){
+        return false;
+    }
+    if(rec.getKey() != key && idIndex.find(rec.getKey()) != nullptr){
+        return false;
+    }
+
+    Slot slot = *found;
+    unindexSlot(slot);
+    recs.edit(slot) = rec;
+    indexSlot(slot);
+    if(rec.getKey() != key){
+        filterId(rec);
+    }
+    return true;
+}
+
+/**
+ * @brief Removes every record and empties all indexes.
+ * */
+void RecordStore::clear(){
+    recs.clear();
+    places.clear();
+    idIndex.clear();
+    firstIndex.clear();
+    lastIndex.clear();
+    dateIndex.clear();
+    rebuildFilter();
+}
+
+/**
+ * Makes room for the given number of records on top of those already stored, so that
+ * inserting them does not grow the id index along the way.
+ * @brief Reserves space for more records.
+ * @param extra The number of records about to be inserted.
+ * */
+void RecordStore::reserve(Slot extra){
+    idIndex.reserve(recs.size() + extra);
+}
+
+/**
+ * Replaces the contents of the store with the given batches of records, taken in order.
+ * This is how a whole database is loaded at once: ids are checked and indexed in a single
+ * pass over every batch, so a duplicate is caught whichever batch it is in, and the three
+ * field indexes, which are independent of each other, are then built on separate threads.
+ * The batches are emptied, since their records are moved into the store.
+ * @brief Loads the store from batches of records.
+ * @param parts The batches of records to load.
+ * @return The records that were left out because an earlier record already had their id.
+ * */
+std::vector<Record> RecordStore::load(std::vector<std::vector<Record>>& parts){
+
+    clear();
+
+    Slot total = 0;
+    for(const std::vector<Record>& part : parts){
+        total += part.size();
+    }
+    idIndex.reserve(total);
+
+    std::vector<Record> duplicates;
+    for(std::vector<Record>& part : parts){
+        for(Record& rec : part){
+            if(idIndex.insert(rec.getKey(), recs.size())){
+                recs.push_back(std::move(rec));
+            }else{
+                duplicates.push_back(std::move(rec));
+            }
+        }
+        part.clear();
+        part.shrink_to_fit();
+    }
+
+    places.resize(recs.size());
+    std::thread firstThread(&RecordStore::buildFieldIndex, this, std::ref(firstIndex), &Record::getfNameKey, &Places::first);
+    std::thread lastThread(&RecordStore::buildFieldIndex, this, std::ref(lastIndex), &Record::getlNameKey, &Places::last);
+    buildFieldIndex(dateIndex, &Record::getDateKey, &Places::date);
+    rebuildFilter();
+    firstThread.join();
+    lastThread.join();
+
+    return duplicates;
+}
+
+/**
+ * Looks up a record through the id index.
+ * @brief Returns the record with the given id.
+ * @param id The id to look up.
+ * @return A pointer to the record, or nullptr if no record has that id. The pointer is
+ *         invalidated by the next change to the store.
+ * */
+const Record* RecordStore::find(std::string_view id) const{
+
+    Key key;
+    if(!idFilter.mightContain(id) || !Record::idKey(id, key)){
+        return nullptr;
+    }
+    return find(key);
+}
+
+/**
+ * @brief Returns the record with the given id key.
+ * @param key The key of the id to look up.
+ * @return A pointer to the record, or nullptr if no record has that key.
+ * */
+const Record* RecordStore::find(Key key) const{
+
+    const Slot *slot = idIndex.find(key);
+    if(slot == nullptr){
+        return nullptr;
+    }
+    return &recs.at(*slot);
+}
+
+/**
+ * Returns every record matching all of the given fields; an empty field matches anything.
+ * The given fields are first turned into keys; a value no record holds has no key, which
+ * answers the query at once. An id is answered from the id index. Otherwise the postings
+ * of each given field are looked up in their index, and the smallest list is walked while
+ * comparing the remaining keys, so the cost is bounded by the rarest value rather than the
+ * size of the store.
+ * @brief Searches the store by any subset of fields.
+ * @param id The id to match, or "".
+ * @param first The first name to match, or "".
+ * @param last The last name to match, or "".
+ * @param date The date to match, or "".
+ * @return A vector containing every matching record.
+ * */
+std::vector<Record> RecordStore::query(const std::string& id, const std::string& first,
+                                       const std::string& last, const std::string& date) const{
+
+    std::vector<Record> result;
+
+    Key idKey = 0, firstKey = 0, lastKey = 0, dateKey = 0;
+    if((!id.empty() && (!idFilter.mightContain(id) || !Record::idKey(id, idKey))) ||
+       (!first.empty() && !Record::nameKey(first, firstKey)) ||
+       (!last.empty() && !Record::nameKey(last, lastKey)) ||
+       (!date.empty() && !Record::dateKey(date, dateKey))){
+        return result;
+    }
+
+    auto matches = [&](const Record& rec){
+        return (first.empty() || rec.getfNameKey() == firstKey) &&
+               (last.empty() || rec.getlNameKey() == lastKey) &&
+               (date.empty() || rec.getDateKey() == dateKey);
+    };
+
+    if(!id.empty()){
+        const Record *rec = find(idKey);
+        if(rec != nullptr && matches(*rec)){
+            result.push_back(*rec);
+        }
+        return result;
+    }
+
+    // Each list given, along with the member of Places linking its slots
+    std::vector<std::pair<const Postings*, Link Places::*>> lists;
+    if(!first.empty()){
+        lists.emplace_back(firstIndex.find(firstKey), &Places::first);
+    }
+    if(!last.empty()){
+        lists.emplace_back(lastIndex.find(lastKey), &Places::last);
+    }
+    if(!date.empty()){
+        lists.emplace_back(dateIndex.find(dateKey), &Places::date);
+    }
+
+    if(lists.empty()){
+        return records();
+    }
+    for(const auto& list : lists){
+        if(list.first == nullptr){
+            return result;
+        }
+    }
+
+    auto smallest = *std::min_element(lists.begin(), lists.end(),
+        [](const std::pair<const Postings*, Link Places::*>& a, const std::pair<const Postings*, Link Places::*>& b){
+            return a.first->size < b.first->size;
+        });
+
+    for(Slot slot = smallest.first->head; slot != NONE; slot = (places.at(slot).*smallest.second).next){
+        const Record& rec = recs.at(slot);
+        if(matches(rec)){
+            result.push_back(rec);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Returns the record at a slot.
+ * @param slot The slot, below size().
+ * @return The record. The reference is invalidated by the next change to the store.
+ * @throws std::out_of_range if the slot holds no record.
+ * */
+const Record& RecordStore::at(Slot slot) const{
+    return recs.at(slot);
+}
+
+/**
+ * The records are copied out of the store; use at() to read them in place.
+ * @brief Returns every record in the store, in slot order.
+ * @return A vector holding the records.
+ * */
+std::vector<Record> RecordStore::records() const{
+    std::vector<Record> all;
+    all.reserve(recs.size());
+    for(Slot slot = 0; slot < recs.size(); slot++){
+        all.push_back(recs[slot]);
+    }
+    return all;
+}
+
+/**
+ * @brief Returns the filter over the ids in the store, for its statistics.
+ * @return The id filter.
+ * */
+const BloomFilter& RecordStore::filter() const{
+    return idFilter;
+}
+
+/**
+ * @brief Returns the number of records in the store.
+ * @return The number of records.
+ * */
+RecordStore::Slot RecordStore::size() const{
+    return recs.size();
+}
+
+/**
+ * @brief Enters the record at the given slot into every index.
+ * @param slot The slot of the record.
+ * */
+void RecordStore::indexSlot(Slot slot){
+    const Record& rec = recs.at(slot);
+    if(places.size() < recs.size()){
+        places.resize(recs.size());
+    }
+    idIndex.edit(rec.getKey()) = slot;
+    addPosting(firstIndex, rec.getfNameKey(), slot, &Places::first);
+    addPosting(lastIndex, rec.getlNameKey(), slot, &Places::last);
+    addPosting(dateIndex, rec.getDateKey(), slot, &Places::date);
+}
+
+/**
+ * @brief Removes the record at the given slot from every index.
+ * @param slot The slot of the record.
+ * */
+void RecordStore::unindexSlot(Slot slot){
+    const Record& rec = recs.at(slot);
+    idIndex.erase(rec.getKey());
+    removePosting(firstIndex, rec.getfNameKey(), slot, &Places::first);
+    removePosting(lastIndex, rec.getlNameKey(), slot, &Places::last);
+    removePosting(dateIndex, rec.getDateKey(), slot, &Places::date);
+}
+
+/**
+ * Called once a record with a new id is in the store. Ids that leave the store stay in the
+ * filter, which only costs an occasional false positive, until it is rebuilt.
+ * @brief Adds a record's id to the id filter.
+ * @param rec The record.
+ * */
+void RecordStore::filterId(const Record& rec){
+    if(idFilter.count() >= idFilter.capacity()){
+        rebuildFilter();
+    }else{
+        idFilter.add(rec.getId());
+    }
+}
+
+/**
+ * The filter is sized for twice the records now in the store, so it can take as many
+ * insertions again before it is full and has to be rebuilt.
+ * @brief Rebuilds the id filter from the records in the store.
+ * */
+void RecordStore::rebuildFilter(){
+    idFilter.reset(std::max<std::size_t>(MIN_FILTER_CAPACITY, 2 * recs.size()));
+    for(Slot slot = 0; slot < recs.size(); slot++){
+        idFilter.add(recs[slot].getId());
+    }
+}
+
+/**
+ * The field indexes are independent of each other, so load() builds them on separate threads;
+ * each writes only its own member of the places, whose chunks all belong to the store after
+ * load() has sized them, so no thread replaces a chunk another is writing.
+ * @brief Fills an empty field index from every record in the store.
+ * @param index The field index to fill.
+ * @param field The accessor of the key of the field being indexed.
+ * @param link The member of Places linking the postings of that index.
+ * */
+void RecordStore::buildFieldIndex(FieldIndex& index, Key (Record::*field)() const, Link Places::*link){
+    for(Slot slot = 0; slot < recs.size(); slot++){
+        addPosting(index, (recs.at(slot).*field)(), slot, link);
+    }
+}
+
+/**
+ * The slot is linked in after the last of the postings, so they stay in the order they were added.
+ * @brief Adds a slot to the postings of a value in a field index.
+ * @param index The field index.
+ * @param key The key of the field value.
+ * @param slot The slot holding that value.
+ * @param link The member of Places linking the postings of this index.
+ * */
+void RecordStore::addPosting(FieldIndex& index, Key key, Slot slot, Link Places::*link){
+
+    Postings& list = index.edit(key);
+    Link added;
+    added.next = NONE;
+    if(list.size == 0){
+        added.prev = NONE;
+        list.head = slot;
+    }else{
+        added.prev = list.tail;
+        (places.edit(list.tail).*link).next = slot;
+    }
+    places.edit(slot).*link = added;
+    list.tail = slot;
+    list.size++;
+}
+
+/**
+ * The slot's neighbours in the postings are known from its Places, so it is unlinked without
+ * searching the list; removal therefore costs the same however many records share the value.
+ * A value left with no postings is erased from the index.
+ * @brief Removes a slot from the postings of a value in a field index.
+ * @param index The field index.
+ * @param key The key of the field value.
+ * @param slot The slot to remove.
+ * @param link The member of Places linking the postings of this index.
+ * */
+void RecordStore::removePosting(FieldIndex& index, Key key, Slot slot, Link Places::*link){
+
+    if(index.find(key) == nullptr){
+        return;
+    }
+
+    Postings& list = index.edit(key);
+    Link removed = places.at(slot).*link;
+    if(removed.prev == NONE){
+        list.head = removed.next;
+    }else{
+        (places.edit(removed.prev).*link).next = removed.next;
+    }
+    if(removed.next == NONE){
+        list.tail = removed.prev;
+    }else{
+        (places.edit(removed.next).*link).prev = removed.prev;
+    }
+    list.size--;
+    if(list.size == 0){
+        index.erase(key);
+    }
+}
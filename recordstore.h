@@ -0,0 +1,92 @@
+/**
+ * The header file for the record store.
+ * This stores the declarations of the indexed record container used by the database class.
+ * @brief The header file for the recordstore class.
+ * @author Justin Teichman
+ * */
+
+#ifndef RECORDSTORE_H
+#define RECORDSTORE_H
+
+#include <record.h>
+#include <bloomfilter.h>
+#include <sharedvector.h>
+#include <sharedmap.h>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+class RecordStore {
+
+    public:
+        typedef std::size_t Slot;
+
+        bool insert(const Record&);
+        bool remove(std::string_view);
+        bool replace(std::string_view, const Record&);
+        void clear();
+        void reserve(Slot);
+        std::vector<Record> load(std::vector<std::vector<Record>>&);
+
+        const Record* find(std::string_view) const;
+        std::vector<Record> query(const std::string&, const std::string&, const std::string&, const std::string&) const;
+
+        const Record& at(Slot) const;
+        std::vector<Record> records() const;
+        const BloomFilter& filter() const;
+        Slot size() const;
+
+    private:
+        typedef std::uint64_t Key;
+        // The postings of a field value are the slots holding it, linked through the
+        // places of those slots in the order they were added
+        struct Postings {
+            Slot head;
+            Slot tail;
+            Slot size;
+        };
+        typedef SharedMap<Postings> FieldIndex;
+
+        // A slot's neighbours in the postings of one of its fields
+        struct Link {
+            Slot prev;
+            Slot next;
+        };
+
+        // Where a record's slot sits in the postings of each of its fields, so it can be
+        // taken out of them without searching
+        struct Places {
+            Link first;
+            Link last;
+            Link date;
+        };
+
+        // Ends the postings: the slot before the first and after the last
+        static const Slot NONE = static_cast<Slot>(-1);
+
+        // Every part of the store is shared with its copies until it is changed (see
+        // SharedVector), so a copy made to be changed costs little more than the change
+        SharedVector<Record> recs;
+        SharedVector<Places> places;  // by slot, alongside recs
+        SharedMap<Slot> idIndex;
+        FieldIndex firstIndex;
+        FieldIndex lastIndex;
+        FieldIndex dateIndex;
+        BloomFilter idFilter;
+
+        // Smallest number of ids the id filter is sized for
+        static const std::size_t MIN_FILTER_CAPACITY = 1024;
+
+        void indexSlot(Slot);
+        void unindexSlot(Slot);
+        void filterId(const Record&);
+        void rebuildFilter();
+        const Record* find(Key) const;
+        void buildFieldIndex(FieldIndex&, Key (Record::*)() const, Link Places::*);
+        void addPosting(FieldIndex&, Key, Slot, Link Places::*);
+        void removePosting(FieldIndex&, Key, Slot, Link Places::*);
+};
+
+#endif
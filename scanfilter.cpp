@@ -0,0 +1,135 @@
+/**
+ * ScanFilter class. A pass held in front of the camera is decoded in frame after
+ * frame, and every one of those frames would otherwise be authenticated: at best
+ * that repeats the same feedback, at worst it lets the holder in and straight back
+ * out again. The filter remembers when each code was last seen, going by
+ * QRCode::getCreationTime(), and turns away a code seen again within the repeat
+ * window. Every sighting restarts the window, so a pass only counts again once it
+ * has been out of view for the whole window.
+ * The cache keeps its codes in the order they were last seen, so the codes whose
+ * window is over are always at the old end: each sighting drops those, and when the
+ * cache is full the oldest code makes room. Both take constant time per code, and
+ * the cache never holds more than a fixed number of codes however many different
+ * codes go past.
+ * @brief Suppresses repeated scans of the same QR code.
+ * @author Austin Hatherell
+ */
+
+#include "scanfilter.h"
+
+/**
+ * Constructor
+ * @brief Creates an empty filter.
+ * @param window      How many seconds a sighting of a code keeps that code from being admitted again.
+ * @param capacity    The most codes the cache holds at once.
+ */
+ScanFilter::ScanFilter(std::time_t window, std::size_t capacity){
+	this->window = window;
+	this->capacity = capacity;
+	checked = 0;
+	hits = 0;
+	suppressed = 0;
+	evicted = 0;
+	index.reserve(capacity);
+}
+
+/**
+ * Decides whether a code should be authenticated, and records the sighting either way.
+ * It is called with every code the camera reads, in the order they were read, but a
+ * code created before its latest sighting is treated as a repeat all the same.
+ * @brief Check a scanned code against the recent sightings.
+ * @param code    The code the camera recognized.
+ * @return True if the code should be authenticated; false if it is a repeat within the window.
+ */
+bool ScanFilter::admit(QRCode code){
+	std::time_t now = code.getCreationTime();
+	checked++;
+
+	expire(now);
+
+	std::string data = code.getData();
+	auto it = index.find(data);
+	if(it != index.end()){
+		hits++;
+		Sighting &sighting = *it->second;
+		bool repeat = now - sighting.seen < window;
+		if(now > sighting.seen){
+			sighting.seen = now;
+			order.splice(order.begin(), order, it->second);
+		}
+		if(repeat){
+			suppressed++;
+			return false;
+		}
+		return true;
+	}
+
+	if(!order.empty() && order.size() >= capacity){ // Every code is still within its window, so one has to go early
+		evictOldest();
+		evicted++;
+	}
+	order.push_front(Sighting{std::move(data), now});
+	index.emplace(order.front().data, order.begin());
+	return true;
+}
+
+/**
+ * Used when a code admit() let through could not be passed on after all, so that the
+ * next sighting of the code is admitted instead of being taken for a repeat.
+ * @brief Forget the sightings of a code.
+ * @param code    The code to forget.
+ */
+void ScanFilter::forget(QRCode code){
+	std::string data = code.getData();
+	auto it = index.find(data);
+	if(it == index.end())
+		return;
+	std::list<Sighting>::iterator sighting = it->second;
+	index.erase(it);
+	order.erase(sighting);
+}
+
+/**
+ * @brief Forget every sighting and reset the counters, e.g. at the start of a session.
+ */
+void ScanFilter::clear(){
+	index.clear();
+	order.clear();
+	checked = 0;
+	hits = 0;
+	suppressed = 0;
+	evicted = 0;
+}
+
+/**
+ * @brief Get the filter's cache size and hit counters.
+ * @return The current counters.
+ */
+ScanFilterStats ScanFilter::stats() const{
+	ScanFilterStats result;
+	result.checked = checked;
+	result.hits = hits;
+	result.suppressed = suppressed;
+	result.size = order.size();
+	result.evicted = evicted;
+	return result;
+}
+
+/**
+ * Only looks at the old end of the cache, and stops at the first code still within
+ * its window, so it costs nothing beyond the codes it removes.
+ * @brief Remove the codes whose window is over.
+ * @param now    The current time, as a creation time.
+ */
+void ScanFilter::expire(std::time_t now){
+	while(!order.empty() && now - order.back().seen >= window)
+		evictOldest();
+}
+
+/**
+ * @brief Remove the code seen longest ago.
+ */
+void ScanFilter::evictOldest(){
+	index.erase(order.back().data);
+	order.pop_back();
+}
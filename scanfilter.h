@@ -0,0 +1,59 @@
+/**
+ * Header for the ScanFilter class, which keeps a camera from authenticating the
+ * same QR code over and over while it stays in view.
+ * @brief The header file for the scanfilter class.
+ * @author Austin Hatherell
+ */
+
+#ifndef SCANFILTER_H
+#define SCANFILTER_H
+
+#include <ctime>
+#include <cstddef>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "qrcode.h"
+
+// Counters describing a ScanFilter, see ScanFilter::stats()
+struct ScanFilterStats {
+	std::size_t checked;    // codes passed to admit()
+	std::size_t hits;       // codes found in the cache, i.e. seen before and not yet expired
+	std::size_t suppressed; // hits within the repeat window, which admit() turned away
+	std::size_t size;       // codes in the cache right now
+	std::size_t evicted;    // codes pushed out of a full cache before their window was over
+};
+
+class ScanFilter{
+	public:
+		ScanFilter(std::time_t window, std::size_t capacity);
+
+		bool admit(QRCode code);
+		void forget(QRCode code);
+		void clear();
+		ScanFilterStats stats() const;
+
+	private:
+		// The latest sighting of a code
+		struct Sighting {
+			std::string data;
+			std::time_t seen; // creation time of the code when it was last seen
+		};
+
+		std::list<Sighting> order; // every code in the cache, most recently seen first
+		std::unordered_map<std::string_view, std::list<Sighting>::iterator> index; // keys point into order's nodes
+		std::time_t window;
+		std::size_t capacity;
+
+		std::size_t checked;
+		std::size_t hits;
+		std::size_t suppressed;
+		std::size_t evicted;
+
+		void expire(std::time_t now);
+		void evictOldest();
+};
+
+#endif
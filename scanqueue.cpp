@@ -0,0 +1,333 @@
+/**
+ * ScanQueue class. It carries decoded QR codes from the thread that reads the camera
+ * to the thread that authenticates them, so that neither ever waits for the other.
+ * It is a bounded ring buffer that any number of threads can push to and pop from at
+ * once without taking a lock: each slot carries a sequence number, and a thread claims
+ * a slot by advancing the shared enqueue or dequeue position with a compare-and-swap.
+ * When codes arrive faster than they are authenticated, a backpressure policy chosen
+ * at construction decides which ones are kept (see ScanQueue::Policy).
+ * The codes read from one frame are pushed as a batch, and are popped together, so
+ * that a group holding up their passes at once is handled at once.
+ * A consumer with nothing to do sleeps in pop() until a code arrives, and a producer
+ * under the Block policy sleeps until there is room; only those waits take a lock.
+ * @brief A lock-free bounded queue of QR codes.
+ * @author Austin Hatherell
+ */
+
+#include "scanqueue.h"
+
+#include <string>
+#include <functional>
+
+/**
+ * Constructor
+ * @brief Creates an empty queue.
+ * @param capacity  The most codes the queue holds; rounded up to a power of two.
+ * @param policy    What to do with codes that arrive when the queue is full.
+ */
+ScanQueue::ScanQueue(std::size_t capacity, Policy policy){
+	std::size_t size = 2;
+	while(size < capacity)
+		size *= 2;
+
+	cells.reset(new Cell[size]);
+	for(std::size_t i = 0; i < size; i++){
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+		cells[i].hash.store(0, std::memory_order_relaxed);
+		cells[i].batch.store(0, std::memory_order_relaxed);
+	}
+	mask = size - 1;
+	this->policy = policy;
+
+	enqueuePos = 0;
+	dequeuePos = 0;
+	closed = false;
+	batches = 0;
+	maxDepth = 0;
+	pushed = 0;
+	popped = 0;
+	dropped = 0;
+	duplicates = 0;
+	blockedPushes = 0;
+}
+
+/**
+ * Adds the codes read from one frame to the back of the queue as a batch, which
+ * tryPop() hands on together. The backpressure policy is applied to each code in
+ * turn when there is no room for it. A consumer sleeping in pop() is woken once the
+ * batch is in, or before this waits for room, so it is not handed half a batch for
+ * nothing. This can be called from any thread.
+ * @brief Push the codes of a frame into the queue.
+ * @param codes    The codes to add, in the order they were read.
+ * @return The codes that were dropped for lack of room, or because the queue was closed. A code
+ *         dropped because the same code is already waiting is not among them, since it will still be handled.
+ */
+std::vector<QRCode> ScanQueue::push(std::vector<QRCode> codes){
+	std::uint64_t batch = ++batches;
+	std::vector<QRCode> turnedAway;
+	bool arrived = false; // a code went into an empty queue, where a consumer may be sleeping
+
+	for(QRCode &code : codes){
+		std::uint64_t hash = std::hash<std::string>()(code.getData());
+
+		if(policy == DropDuplicates && isWaiting(hash)){
+			duplicates++;
+			dropped++;
+			continue;
+		}
+
+		std::size_t pos;
+		bool queued = true;
+		while(queued && !tryPush(code, hash, batch, pos)){
+			if(closed){
+				queued = false;
+			}else if(policy == DropOldest){
+				QRCode oldest;
+				std::uint64_t oldestBatch;
+				if(tryTake(oldest, oldestBatch, false))
+					dropped++;
+			}else if(policy == DropDuplicates){
+				dropped++;
+				queued = false;
+			}else{
+				if(arrived){ // Only a consumer can make room
+					wake(notEmpty);
+					arrived = false;
+				}
+				std::unique_lock<std::mutex> guard(waitLock);
+				blockedPushes++;
+				notFull.wait(guard, [this]{ return closed || canPush(); });
+				blockedPushes--;
+			}
+		}
+		if(!queued){
+			turnedAway.push_back(code);
+			continue;
+		}
+
+		pushed++;
+
+		// Pairs with the fence in canTake(): either a consumer about to sleep sees this code,
+		// or this sees the dequeue position it is waiting at, and wakes it
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::size_t out = dequeuePos.load(std::memory_order_relaxed);
+		std::size_t depth = pos + 1 > out ? pos + 1 - out : 0;
+		if(depth == 1)
+			arrived = true;
+
+		std::size_t highest = maxDepth.load(std::memory_order_relaxed);
+		while(depth > highest && !maxDepth.compare_exchange_weak(highest, depth, std::memory_order_relaxed)){
+		}
+	}
+
+	if(arrived)
+		wake(notEmpty);
+	return turnedAway;
+}
+
+/**
+ * Takes a batch of codes (see tryPop()), sleeping until one arrives if the queue
+ * is empty. This can be called from any thread.
+ * @brief Pop a batch of codes from the queue, waiting for one if need be.
+ * @param codes    Receives the codes taken from the queue, in the order they were pushed.
+ * @return True if any code was taken; false if the queue was closed (see close()).
+ */
+bool ScanQueue::pop(std::vector<QRCode> &codes){
+	for(;;){
+		if(closed)
+			return false;
+		if(tryPop(codes))
+			return true;
+		std::unique_lock<std::mutex> guard(waitLock);
+		notEmpty.wait(guard, [this]{ return closed || canTake(); });
+	}
+}
+
+/**
+ * Takes the code at the front of the queue, along with the codes behind it that were
+ * pushed in the same batch. Codes of the batch that the backpressure policy dropped are
+ * left out. A batch is pushed code after code, so a consumer that gets to it while it is
+ * still being pushed takes the rest as a batch of its own. This never waits, and can be
+ * called from any thread.
+ * @brief Pop a batch of codes from the queue.
+ * @param codes    Receives the codes taken from the queue, in the order they were pushed.
+ * @return True if any code was taken; false if the queue was empty.
+ */
+bool ScanQueue::tryPop(std::vector<QRCode> &codes){
+	codes.clear();
+	QRCode code;
+	std::uint64_t batch;
+	if(!tryTake(code, batch, false))
+		return false;
+	do{
+		codes.push_back(std::move(code));
+		popped++;
+	}while(tryTake(code, batch, true));
+	return true;
+}
+
+/**
+ * Claims the slot at the dequeue position and empties it, unless the queue is empty
+ * (or, when sameBatch is set, the code there belongs to another batch).
+ * @brief Try once to take a code from the queue.
+ * @param code         Receives the code taken from the queue.
+ * @param batch        Receives the batch the code was pushed in; with sameBatch, the batch to take from.
+ * @param sameBatch    Only take the code if it was pushed in the given batch.
+ * @return True if a code was taken; false if there was none to take.
+ */
+bool ScanQueue::tryTake(QRCode &code, std::uint64_t &batch, bool sameBatch){
+	Cell *cell;
+	std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+	for(;;){
+		cell = &cells[pos & mask];
+		std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) (pos + 1);
+		if(difference == 0){
+			if(sameBatch && cell->batch.load(std::memory_order_relaxed) != batch)
+				return false; // the next code was pushed in another batch
+			if(dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}else if(difference < 0){
+			return false; // the slot hasn't been filled yet, so the queue is empty
+		}else{
+			pos = dequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	batch = cell->batch.load(std::memory_order_relaxed);
+	code = std::move(cell->code);
+	cell->sequence.store(pos + mask + 1, std::memory_order_release);
+
+	// Pairs with the fence in canPush(), as in push()
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(blockedPushes.load(std::memory_order_relaxed) > 0)
+		wake(notFull);
+	return true;
+}
+
+/**
+ * Closing the queue releases any producer blocked in push() under the Block
+ * policy, and any consumer waiting in pop(). Codes already in the queue can
+ * still be taken with tryPop().
+ * @brief Stop producers and consumers from waiting.
+ */
+void ScanQueue::close(){
+	closed = true;
+	wake(notFull);
+	wake(notEmpty);
+}
+
+/**
+ * @brief Let producers and consumers wait again after close().
+ */
+void ScanQueue::reopen(){
+	closed = false;
+}
+
+/**
+ * The counters are read one at a time while the queue may be in use, so they
+ * are each accurate, but not necessarily consistent with one another.
+ * @brief Get the queue's depth and drop counters.
+ * @return The current counters.
+ */
+ScanQueueStats ScanQueue::stats() const{
+	ScanQueueStats result;
+	std::size_t out = dequeuePos.load(std::memory_order_relaxed);
+	std::size_t in = enqueuePos.load(std::memory_order_relaxed);
+	result.depth = in > out ? in - out : 0;
+	result.maxDepth = maxDepth;
+	result.pushed = pushed;
+	result.popped = popped;
+	result.dropped = dropped;
+	result.duplicates = duplicates;
+	return result;
+}
+
+/**
+ * Claims the slot at the enqueue position and fills it, unless the queue is full.
+ * @brief Try once to push a code into the queue.
+ * @param code     The code to add; it is moved from if the push succeeds.
+ * @param hash     The hash of the code's data.
+ * @param batch    The batch the code is pushed in.
+ * @param pos      Receives the position the code was pushed at.
+ * @return True if the code was queued; false if the queue was full.
+ */
+bool ScanQueue::tryPush(QRCode &code, std::uint64_t hash, std::uint64_t batch, std::size_t &pos){
+	Cell *cell;
+	pos = enqueuePos.load(std::memory_order_relaxed);
+	for(;;){
+		cell = &cells[pos & mask];
+		std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) pos;
+		if(difference == 0){
+			if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}else if(difference < 0){
+			return false; // the slot still holds a code from the previous lap, so the queue is full
+		}else{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->code = std::move(code);
+	cell->hash.store(hash, std::memory_order_relaxed);
+	cell->batch.store(batch, std::memory_order_relaxed);
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+ * Every slot between the dequeue and enqueue positions is checked, so a code is found
+ * wherever it waits, even when each frame holds several codes. That is at most the
+ * capacity of the queue, which is small. A code being taken out at that very moment may
+ * still be seen as waiting, which does no harm, since it is about to be handled.
+ * @brief Check whether a code is already waiting in the queue.
+ * @param hash    The hash of the code's data.
+ * @return True if a code with this hash has been pushed and not popped yet.
+ */
+bool ScanQueue::isWaiting(std::uint64_t hash) const{
+	std::size_t front = dequeuePos.load(std::memory_order_relaxed);
+	std::size_t back = enqueuePos.load(std::memory_order_relaxed);
+	for(std::size_t pos = front; pos < back; pos++){
+		const Cell &cell = cells[pos & mask];
+		if(cell.sequence.load(std::memory_order_acquire) == pos + 1 && cell.hash.load(std::memory_order_relaxed) == hash)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Called with waitLock held, by a consumer deciding whether to sleep.
+ * @brief Check whether the code at the front of the queue can be taken.
+ * @return True if the slot at the dequeue position holds a code.
+ */
+bool ScanQueue::canTake() const{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+	return cells[pos & mask].sequence.load(std::memory_order_acquire) == pos + 1;
+}
+
+/**
+ * Called with waitLock held, by a blocked producer deciding whether to sleep.
+ * @brief Check whether there is room to push a code.
+ * @return True if the slot at the enqueue position is free, or has been claimed since.
+ */
+bool ScanQueue::canPush() const{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+	std::size_t sequence = cells[pos & mask].sequence.load(std::memory_order_acquire);
+	return (std::ptrdiff_t) sequence - (std::ptrdiff_t) pos >= 0;
+}
+
+/**
+ * Taking the lock before notifying means a thread that has just found it cannot go on,
+ * and is about to sleep, is already waiting when the notification is sent.
+ * @brief Wake every thread waiting on a condition.
+ * @param waiters    notEmpty or notFull.
+ */
+void ScanQueue::wake(std::condition_variable &waiters){
+	{
+		std::lock_guard<std::mutex> guard(waitLock);
+	}
+	waiters.notify_all();
+}
@@ -0,0 +1,96 @@
+/**
+ * Header for the ScanQueue class, the bounded queue that carries decoded QR codes
+ * from the camera to authentication.
+ * @brief The header file for the scanqueue class.
+ * @author Austin Hatherell
+ */
+
+#ifndef SCANQUEUE_H
+#define SCANQUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "qrcode.h"
+
+// Counters describing a ScanQueue, see ScanQueue::stats()
+struct ScanQueueStats {
+	std::size_t depth;      // codes waiting in the queue right now
+	std::size_t maxDepth;   // most codes that have ever been waiting at once
+	std::size_t pushed;     // codes accepted into the queue
+	std::size_t popped;     // codes taken out of the queue
+	std::size_t dropped;    // codes thrown away by the backpressure policy, duplicates included
+	std::size_t duplicates; // codes thrown away because the same code was already waiting
+};
+
+class ScanQueue{
+	public:
+		// What push() does when the queue is full (or, for DropDuplicates, when the code is already waiting)
+		enum Policy {
+			DropOldest,     // discard the oldest waiting code to make room
+			DropDuplicates, // discard a code that is already waiting; when full, discard the new code
+			Block           // wait until there is room (or the queue is closed)
+		};
+
+		ScanQueue(std::size_t capacity, Policy policy);
+
+		std::vector<QRCode> push(std::vector<QRCode> codes);
+		bool pop(std::vector<QRCode> &codes);
+		bool tryPop(std::vector<QRCode> &codes);
+		void close();
+		void reopen();
+		ScanQueueStats stats() const;
+
+	private:
+		// One slot of the ring. Its sequence number says whose turn it is: a producer may fill
+		// the slot when it equals the enqueue position, a consumer may empty it when it equals
+		// that position plus one. The hash and batch are atomic so that they can be read
+		// by threads checking the slot (see isWaiting()) while it changes hands.
+		struct Cell {
+			std::atomic<std::size_t> sequence;
+			std::atomic<std::uint64_t> hash;  // hash of the code's data
+			std::atomic<std::uint64_t> batch; // the push() call the code came from
+			QRCode code;
+		};
+
+		std::unique_ptr<Cell[]> cells;
+		std::size_t mask;
+		Policy policy;
+
+		// Kept on separate cache lines so producers and consumers don't slow each other down
+		alignas(64) std::atomic<std::size_t> enqueuePos;
+		alignas(64) std::atomic<std::size_t> dequeuePos;
+		alignas(64) std::atomic<bool> closed;
+
+		std::atomic<std::uint64_t> batches;       // push() calls so far, numbering the batches
+
+		std::atomic<std::size_t> maxDepth;
+		std::atomic<std::size_t> pushed;
+		std::atomic<std::size_t> popped;
+		std::atomic<std::size_t> dropped;
+		std::atomic<std::size_t> duplicates;
+
+		// Only threads that have to wait take the lock: pop() while the queue is empty, and
+		// push() under the Block policy while it is full. The ring itself stays lock-free.
+		std::mutex waitLock;
+		std::condition_variable notEmpty;     // a code has arrived in an empty queue
+		std::condition_variable notFull;      // room has been made while a push() was blocked
+		std::atomic<std::size_t> blockedPushes; // push() calls waiting on notFull
+
+		bool tryPush(QRCode &code, std::uint64_t hash, std::uint64_t batch, std::size_t &pos);
+		bool tryTake(QRCode &code, std::uint64_t &batch, bool sameBatch);
+		bool isWaiting(std::uint64_t hash) const;
+		bool canTake() const;
+		bool canPush() const;
+		void wake(std::condition_variable &waiters);
+
+		ScanQueue(const ScanQueue&) = delete;
+		ScanQueue& operator=(const ScanQueue&) = delete;
+};
+
+#endif
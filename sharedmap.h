@@ -0,0 +1,334 @@
+/**
+ * The header file for the shared map.
+ * A hash map from 64-bit keys that copies of it share, the counterpart of SharedVector for
+ * the indexes of the record store. Entries are spread over shards by key, and copying a
+ * SharedMap only copies the pointers to its shards. A shard is copied the first time one of
+ * the maps sharing it writes to it, so a change costs one shard of about SHARD_ENTRIES
+ * entries however many the map holds. Shards are owned the same way as the chunks of a
+ * SharedVector: copying a map gives both maps a new owner, so neither writes to a shard the
+ * other still uses. Reading a map that no thread is changing is safe from any thread.
+ * Each shard is an open-addressing table whose entries are reached straight from the map,
+ * so a lookup usually touches a single cache line of the shard.
+ * @brief The header file for the sharedmap class.
+ * @author Justin Teichman
+ * */
+
+#ifndef SHAREDMAP_H
+#define SHAREDMAP_H
+
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+template<typename V>
+class SharedMap {
+
+    public:
+        typedef std::uint64_t Key;
+
+        /**
+         * Constructor
+         * @brief Creates an empty map.
+         * */
+        SharedMap(){
+            count = 0;
+            owner = newOwner();
+            shards.resize(1);
+        }
+
+        /**
+         * Constructor
+         * The copy shares every shard with the original, which is why both take a new owner.
+         * @brief Creates a copy of a map, sharing its shards.
+         * @param other The map to copy.
+         * */
+        SharedMap(const SharedMap& other) : shards(other.shards){
+            count = other.count;
+            owner = newOwner();
+            other.owner = newOwner();
+        }
+
+        /**
+         * @brief Makes this map a copy of another, sharing its shards (see the copy constructor).
+         * @param other The map to copy.
+         * @return This map.
+         * */
+        SharedMap& operator=(const SharedMap& other){
+            if(this != &other){
+                shards = other.shards;
+                count = other.count;
+                owner = newOwner();
+                other.owner = newOwner();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Returns the number of entries.
+         * @return The size of the map.
+         * */
+        std::size_t size() const{
+            return count;
+        }
+
+        /**
+         * @brief Looks up a key.
+         * @param key The key to look up.
+         * @return A pointer to its value, or nullptr if the key is not in the map. The pointer
+         *         is invalidated by the next change to the map.
+         * */
+        const V* find(Key key) const{
+            std::uint64_t hash = mix(key);
+            const Ref& ref = shards[hash & (shards.size() - 1)];
+            if(ref.entries == nullptr){
+                return nullptr;
+            }
+            for(std::size_t i = (hash >> 32) & ref.mask; ref.entries[i].used; i = (i + 1) & ref.mask){
+                if(ref.entries[i].key == key){
+                    return &ref.entries[i].value;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * Copies the key's shard first if it is shared (see the class description), and adds
+         * the key with a default value if it is not in the map. The reference is invalidated
+         * by the next change to the map.
+         * @brief Returns the value of a key to be changed.
+         * @param key The key.
+         * @return Its value.
+         * */
+        V& edit(Key key){
+            return place(key).value;
+        }
+
+        /**
+         * @brief Adds a key, unless it is already in the map.
+         * @param key The key to add.
+         * @param value Its value.
+         * @return true if the key was added, false if it was already there.
+         * */
+        bool insert(Key key, V value){
+            if(find(key) != nullptr){
+                return false;
+            }
+            place(key).value = std::move(value);
+            return true;
+        }
+
+        /**
+         * Entries after it in its run are moved back into the gap, so that no lookup stops
+         * short of them and no markers of removed entries pile up.
+         * @brief Removes a key.
+         * @param key The key to remove.
+         * @return true if the key was removed, false if it was not in the map.
+         * */
+        bool erase(Key key){
+            if(find(key) == nullptr){
+                return false;
+            }
+            std::uint64_t hash = mix(key);
+            std::size_t shard = hash & (shards.size() - 1);
+            std::vector<Entry>& entries = own(shard);
+            std::size_t mask = entries.size() - 1;
+            std::size_t gap = (hash >> 32) & mask;
+            while(entries[gap].key != key){
+                gap = (gap + 1) & mask;
+            }
+            for(std::size_t i = (gap + 1) & mask; entries[i].used; i = (i + 1) & mask){
+                std::size_t home = (mix(entries[i].key) >> 32) & mask;
+                if(((i - home) & mask) >= ((i - gap) & mask)){
+                    entries[gap] = std::move(entries[i]);
+                    gap = i;
+                }
+            }
+            entries[gap] = Entry();
+            shards[shard].shard->used--;
+            count--;
+            return true;
+        }
+
+        /**
+         * @brief Removes every entry.
+         * */
+        void clear(){
+            shards.assign(1, Ref());
+            count = 0;
+        }
+
+        /**
+         * Spreads the entries over enough shards for the given number of them, so adding that
+         * many does not reshard the map along the way.
+         * @brief Makes room for a number of entries.
+         * @param size The number of entries the map is about to hold.
+         * */
+        void reserve(std::size_t size){
+            std::size_t wanted = shards.size();
+            while(wanted * SHARD_ENTRIES < size){
+                wanted *= 2;
+            }
+            if(wanted > shards.size()){
+                reshard(wanted);
+            }
+        }
+
+    private:
+        // Entries per shard before the map is spread over twice as many: about the most a
+        // single change has to copy
+        static const std::size_t SHARD_ENTRIES = 1024;
+
+        struct Entry {
+            Key key = 0;
+            bool used = false;
+            V value = V();
+        };
+
+        struct Shard {
+            std::uint64_t owner;     // the map that made this shard, and so may write to it
+            std::size_t used;        // entries in use; kept under 3/4 of them
+            std::vector<Entry> entries;  // a power of two of them
+
+            Shard(std::uint64_t maker, std::size_t size) : owner(maker), used(0), entries(size){}
+        };
+
+        // A shard, along with where its entries are, so that a lookup goes straight to them
+        struct Ref {
+            std::shared_ptr<Shard> shard;
+            Entry *entries = nullptr;
+            std::size_t mask = 0;
+
+            void point(){
+                entries = shard->entries.data();
+                mask = shard->entries.size() - 1;
+            }
+        };
+
+        std::vector<Ref> shards;    // a power of two of them; empty ones have no shard
+        std::size_t count;
+        mutable std::uint64_t owner;    // changed when the map is copied, see the copy constructor
+
+        static std::atomic<std::uint64_t> owners;
+
+        /**
+         * @brief Returns a number that no map has been given as its owner yet.
+         * @return The new owner.
+         * */
+        static std::uint64_t newOwner(){
+            return ++owners;
+        }
+
+        /**
+         * Keys are mixed first, since ids often differ only in their low bits and name keys
+         * are aligned addresses. The low bits pick the shard and the high ones the entry.
+         * @brief Hashes a key.
+         * @param key The key.
+         * @return The hash of the key.
+         * */
+        static std::uint64_t mix(Key key){
+            key = (key ^ (key >> 33)) * 0xFF51AFD7ED558CCDULL;
+            key = (key ^ (key >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+            return key ^ (key >> 33);
+        }
+
+        /**
+         * @brief Returns the entries of a shard this map may write to, creating the shard or copying it first as needed.
+         * @param index The index of the shard.
+         * @return The entries of the shard.
+         * */
+        std::vector<Entry>& own(std::size_t index){
+            Ref& ref = shards[index];
+            if(!ref.shard){
+                ref.shard = std::make_shared<Shard>(owner, 8);
+                ref.point();
+            }else if(ref.shard->owner != owner){
+                std::shared_ptr<Shard> copy = std::make_shared<Shard>(owner, 0);
+                copy->used = ref.shard->used;
+                copy->entries = ref.shard->entries;
+                ref.shard = std::move(copy);
+                ref.point();
+            }
+            return ref.shard->entries;
+        }
+
+        /**
+         * @brief Returns the entry of a key, adding it with a default value if it is not in the map.
+         * @param key The key.
+         * @return Its entry, in a shard this map may write to.
+         * */
+        Entry& place(Key key){
+            std::uint64_t hash = mix(key);
+            std::size_t shard = hash & (shards.size() - 1);
+            std::vector<Entry> *entries = &own(shard);
+            std::size_t mask = entries->size() - 1;
+            std::size_t i = (hash >> 32) & mask;
+            for(; (*entries)[i].used; i = (i + 1) & mask){
+                if((*entries)[i].key == key){
+                    return (*entries)[i];
+                }
+            }
+
+            if(count + 1 > shards.size() * SHARD_ENTRIES){
+                reshard(shards.size() * 2);
+                return place(key);
+            }
+            if(4 * (shards[shard].shard->used + 1) > 3 * entries->size()){
+                grow(shard);
+                return place(key);
+            }
+            (*entries)[i].key = key;
+            (*entries)[i].used = true;
+            shards[shard].shard->used++;
+            count++;
+            return (*entries)[i];
+        }
+
+        /**
+         * @brief Doubles the entries of a shard this map owns.
+         * @param index The index of the shard.
+         * */
+        void grow(std::size_t index){
+            Ref& ref = shards[index];
+            std::vector<Entry> old(ref.shard->entries.size() * 2);
+            old.swap(ref.shard->entries);
+            ref.point();
+            for(Entry& entry : old){
+                if(entry.used){
+                    std::size_t i = (mix(entry.key) >> 32) & ref.mask;
+                    while(ref.entries[i].used){
+                        i = (i + 1) & ref.mask;
+                    }
+                    ref.entries[i] = std::move(entry);
+                }
+            }
+        }
+
+        /**
+         * Moves every entry into a new set of shards; this copies the whole map, but only as
+         * often as its size doubles.
+         * @brief Spreads the entries over the given number of shards.
+         * @param size The new number of shards, a power of two.
+         * */
+        void reshard(std::size_t size){
+            std::vector<Ref> old(size);
+            old.swap(shards);
+            count = 0;
+            for(const Ref& ref : old){
+                if(ref.shard){
+                    for(const Entry& entry : ref.shard->entries){
+                        if(entry.used){
+                            place(entry.key).value = entry.value;
+                        }
+                    }
+                }
+            }
+        }
+};
+
+template<typename V>
+std::atomic<std::uint64_t> SharedMap<V>::owners(0);
+
+#endif
@@ -0,0 +1,267 @@
+/**
+ * The header file for the shared vector.
+ * A vector split into chunks of CHUNK elements that copies of it share, so that the record
+ * store can be copied for every change (see Database::draft()) without copying its records.
+ * Copying a SharedVector only copies the pointers to its chunks. A chunk is copied the first
+ * time one of the vectors sharing it writes to it, so a change costs about one chunk
+ * however long the vector is, and a vector that is only read is never copied at all.
+ * Each vector knows which chunks it made itself and may write them in place. Copying a vector
+ * gives both the copy and the original a new owner, so neither writes to a chunk the other
+ * still uses. Reading a vector that no thread is changing is safe from any thread.
+ * The vector is a template so that it can hold records as well as index entries.
+ * @brief The header file for the sharedvector class.
+ * @author Justin Teichman
+ * */
+
+#ifndef SHAREDVECTOR_H
+#define SHAREDVECTOR_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+template<typename T>
+class SharedVector {
+
+    public:
+        /**
+         * Constructor
+         * @brief Creates an empty vector.
+         * */
+        SharedVector(){
+            count = 0;
+            owner = newOwner();
+        }
+
+        /**
+         * Constructor
+         * The copy shares every chunk with the original, which is why both take a new owner.
+         * @brief Creates a copy of a vector, sharing its chunks.
+         * @param other The vector to copy.
+         * */
+        SharedVector(const SharedVector& other) : chunks(other.chunks){
+            count = other.count;
+            owner = newOwner();
+            other.owner = newOwner();
+        }
+
+        /**
+         * Constructor
+         * @brief Moves a vector, which keeps its chunks and their ownership.
+         * @param other The vector to move from; it is left empty.
+         * */
+        SharedVector(SharedVector&& other) noexcept : chunks(std::move(other.chunks)){
+            count = other.count;
+            owner = other.owner;
+            other.chunks.clear();
+            other.count = 0;
+            other.owner = newOwner();
+        }
+
+        /**
+         * @brief Makes this vector a copy of another, sharing its chunks (see the copy constructor).
+         * @param other The vector to copy.
+         * @return This vector.
+         * */
+        SharedVector& operator=(const SharedVector& other){
+            if(this != &other){
+                chunks = other.chunks;
+                count = other.count;
+                owner = newOwner();
+                other.owner = newOwner();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Moves another vector into this one (see the move constructor).
+         * @param other The vector to move from; it is left empty.
+         * @return This vector.
+         * */
+        SharedVector& operator=(SharedVector&& other) noexcept{
+            if(this != &other){
+                chunks = std::move(other.chunks);
+                count = other.count;
+                owner = other.owner;
+                other.chunks.clear();
+                other.count = 0;
+                other.owner = newOwner();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Returns the number of elements.
+         * @return The size of the vector.
+         * */
+        std::size_t size() const{
+            return count;
+        }
+
+        /**
+         * @brief Checks whether the vector has no elements.
+         * @return true if the vector is empty.
+         * */
+        bool empty() const{
+            return count == 0;
+        }
+
+        /**
+         * @brief Reads an element, without checking the index.
+         * @param index The index of the element.
+         * @return The element.
+         * */
+        const T& operator[](std::size_t index) const{
+            return chunks[index / CHUNK].items[index % CHUNK];
+        }
+
+        /**
+         * @brief Reads an element.
+         * @param index The index of the element.
+         * @return The element.
+         * @throws std::out_of_range if there is no such element.
+         * */
+        const T& at(std::size_t index) const{
+            if(index >= count){
+                throw std::out_of_range("SharedVector::at");
+            }
+            return (*this)[index];
+        }
+
+        /**
+         * @brief Reads the last element; the vector must not be empty.
+         * @return The last element.
+         * */
+        const T& back() const{
+            return (*this)[count - 1];
+        }
+
+        /**
+         * Copies the element's chunk first if it is shared (see the class description). The
+         * reference is invalidated by the next change to the vector.
+         * @brief Returns an element to be changed.
+         * @param index The index of the element.
+         * @return The element.
+         * @throws std::out_of_range if there is no such element.
+         * */
+        T& edit(std::size_t index){
+            if(index >= count){
+                throw std::out_of_range("SharedVector::edit");
+            }
+            return own(index / CHUNK)[index % CHUNK];
+        }
+
+        /**
+         * @brief Appends an element.
+         * @param item The element to append.
+         * */
+        void push_back(T item){
+            if(count % CHUNK == 0){
+                chunks.push_back(Ref(owner));
+            }
+            std::vector<T>& items = own(count / CHUNK);
+            items.push_back(std::move(item));
+            chunks[count / CHUNK].items = items.data();
+            count++;
+        }
+
+        /**
+         * @brief Removes the last element; the vector must not be empty.
+         * */
+        void pop_back(){
+            count--;
+            if(count % CHUNK == 0){
+                chunks.pop_back();
+            }else{
+                own(count / CHUNK).pop_back();
+            }
+        }
+
+        /**
+         * @brief Grows or shrinks the vector to the given size, filling new elements with T().
+         * @param size The new size.
+         * */
+        void resize(std::size_t size){
+            while(count > size){
+                pop_back();
+            }
+            while(count < size){
+                if(count % CHUNK == 0){
+                    chunks.push_back(Ref(owner));
+                }
+                std::vector<T>& items = own(count / CHUNK);
+                std::size_t fill = std::min(size - count, CHUNK - items.size());
+                items.resize(items.size() + fill);
+                chunks[count / CHUNK].items = items.data();
+                count += fill;
+            }
+        }
+
+        /**
+         * @brief Removes every element.
+         * */
+        void clear(){
+            chunks.clear();
+            count = 0;
+        }
+
+    private:
+        // Elements per chunk: the most a single change has to copy
+        static const std::size_t CHUNK = 1024;
+
+        struct Chunk {
+            std::uint64_t owner;     // the vector that made this chunk, and so may write to it
+            std::vector<T> items;
+
+            explicit Chunk(std::uint64_t maker) : owner(maker){}
+        };
+
+        // A chunk, along with where its elements are, so that reading one takes no more
+        // memory accesses than reading a plain vector
+        struct Ref {
+            std::shared_ptr<Chunk> chunk;
+            T *items;
+
+            explicit Ref(std::uint64_t maker) : chunk(std::make_shared<Chunk>(maker)), items(nullptr){}
+        };
+
+        std::vector<Ref> chunks;
+        std::size_t count;
+        mutable std::uint64_t owner;    // changed when the vector is copied, see the copy constructor
+
+        static std::atomic<std::uint64_t> owners;
+
+        /**
+         * @brief Returns a number that no vector has been given as its owner yet.
+         * @return The new owner.
+         * */
+        static std::uint64_t newOwner(){
+            return ++owners;
+        }
+
+        /**
+         * The caller updates the chunk's Ref if it makes the elements move.
+         * @brief Returns the elements of a chunk this vector may write to, copying the chunk first if it belongs to another.
+         * @param index The index of the chunk.
+         * @return The elements of the chunk.
+         * */
+        std::vector<T>& own(std::size_t index){
+            Ref& ref = chunks[index];
+            if(ref.chunk->owner != owner){
+                std::shared_ptr<Chunk> copy = std::make_shared<Chunk>(owner);
+                copy->items = ref.chunk->items;
+                ref.chunk = std::move(copy);
+                ref.items = ref.chunk->items.data();
+            }
+            return ref.chunk->items;
+        }
+};
+
+template<typename T>
+std::atomic<std::uint64_t> SharedVector<T>::owners(0);
+
+#endif
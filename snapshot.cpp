@@ -0,0 +1,246 @@
+/**
+ * Binary snapshots of the vax database.
+ * Parsing the comma separated database file on every launch repeats the same work, since the
+ * data rarely changes between boots. A snapshot stores the same records in a fixed-width binary
+ * layout (see snapshot.h) that can be read straight out of a memory-mapped file: ids are stored
+ * as 64-bit numbers, dates as day numbers, and every distinct string only once in a string heap.
+ * A snapshot is stamped with the size and modification time of the text file it was made from,
+ * and is only used while that file is unchanged, so vaxData.txt remains the file to edit and
+ * exchange. Snapshots are versioned and checksummed, and a snapshot that does not check out is
+ * simply ignored.
+ * @brief Writes and reads binary snapshots of the vax database.
+ * @author Justin Teichman
+ * */
+#include <snapshot.h>
+#include <mappedfile.h>
+#include <namepool.h>
+#include <fstream>
+#include <unordered_map>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char SNAPSHOT_MAGIC[8] = {'V', 'A', 'X', 'S', 'N', 'A', 'P', '\0'};
+
+// Largest numeric id (see Record::parseNumericId()), and the day numbers of 0000.01.01 and
+// 9999.12.31, the range of dates that can be written as YYYY.MM.DD
+static const std::uint64_t MAX_NUMERIC_ID = 999999999999999999ULL;
+static const std::int32_t MIN_DAY = -719528;
+static const std::int32_t MAX_DAY = 2932896;
+
+/**
+ * Writes the records as a snapshot of the given text file.
+ * The snapshot is written to a temporary file that is flushed to disk and then renamed over
+ * the old snapshot, so a snapshot is never left half written.
+ * @brief Writes a binary snapshot of a set of records.
+ * @param path The path of the snapshot file.
+ * @param recs The records to write.
+ * @param source The text file holding the same records, or "" if there is none.
+ * @return true if the snapshot was written, false otherwise.
+ * */
+bool Snapshot::write(const std::string& path, const std::vector<Record>& recs, const std::string& source){
+
+    std::vector<Entry> entries;
+    entries.reserve(recs.size());
+    std::string heap;
+    std::unordered_map<std::string, std::uint32_t> offsets;
+    bool fits = true;
+
+    // Adds a string to the heap, unless it is already there, and returns its offset
+    auto intern = [&](const std::string& text) -> std::uint32_t {
+        auto it = offsets.find(text);
+        if(it != offsets.end()){
+            return it->second;
+        }
+        if(text.size() > UINT16_MAX || heap.size() > INT32_MAX){
+            fits = false;
+            return 0;
+        }
+        std::uint32_t offset = heap.size();
+        std::uint16_t length = text.size();
+        heap.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        heap.append(text);
+        offsets.emplace(text, offset);
+        return offset;
+    };
+
+    for(const Record& rec : recs){
+        Entry entry = Entry();
+        if(!Record::parseNumericId(rec.getId(), entry.id)){
+            entry.id = intern(std::string(rec.getId()));
+            entry.flags |= TEXT_ID;
+        }
+        entry.first = intern(rec.getfName());
+        entry.last = intern(rec.getlName());
+        if(!Record::parseDay(rec.getDate(), entry.day)){
+            entry.day = intern(std::string(rec.getDate()));
+            entry.flags |= TEXT_DATE;
+        }
+        entries.push_back(entry);
+    }
+    if(!fits){
+        return false;
+    }
+
+    Header header = Header();
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.count = entries.size();
+    header.heapBytes = heap.size();
+    if(!source.empty() && !stamp(source, header.sourceSize, header.sourceMtime)){
+        return false;
+    }
+    header.checksum = checksum(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry), 14695981039346656037ULL);
+    header.checksum = checksum(heap.data(), heap.size(), header.checksum);
+
+    std::string temp = path + ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    out.write(heap.data(), heap.size());
+    out.close();
+    if(out.fail()){
+        remove(temp.c_str());
+        return false;
+    }
+
+    int fd = ::open(temp.c_str(), O_RDONLY);
+    if(fd >= 0){
+        fsync(fd);
+        ::close(fd);
+    }
+    return rename(temp.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * Reads the records of a snapshot, appending them to recs in the order they were written.
+ * The file is memory-mapped and its entries decoded in place. Nothing is read unless the
+ * snapshot has the right version, size and checksum and, when a source is given, was made
+ * from that file as it is now.
+ * @brief Reads the records of a binary snapshot.
+ * @param path The path of the snapshot file.
+ * @param recs Receives the records of the snapshot.
+ * @param source The text file the snapshot must have been made from, or "" to accept any snapshot.
+ * @return true if the snapshot was read, false if it is missing, stale or damaged.
+ * */
+bool Snapshot::read(const std::string& path, std::vector<Record>& recs, const std::string& source){
+
+    MappedFile file;
+    if(!file.open(path) || file.size() < sizeof(Header)){
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, file.data(), sizeof(header));
+    if(memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION){
+        return false;
+    }
+
+    std::uint64_t entryBytes = static_cast<std::uint64_t>(header.count) * sizeof(Entry);
+    if(sizeof(Header) + entryBytes + header.heapBytes != file.size()){
+        return false;
+    }
+
+    if(!source.empty()){
+        std::uint64_t size;
+        std::int64_t mtime;
+        if(!stamp(source, size, mtime) || size != header.sourceSize || mtime != header.sourceMtime){
+            return false;
+        }
+    }
+
+    const char *body = file.data() + sizeof(Header);
+    if(checksum(body, entryBytes + header.heapBytes, 14695981039346656037ULL) != header.checksum){
+        return false;
+    }
+
+    // Every string in the heap is pooled once, up front, so each entry only has to look up
+    // the offsets it refers to instead of turning its fields back into text
+    const char *heap = body + entryBytes;
+    std::unordered_map<std::uint64_t, const std::string*> pooled;
+    NamePool& pool = NamePool::instance();
+    for(std::uint64_t offset = 0; offset < header.heapBytes; ){
+        std::uint16_t length;
+        if(offset + sizeof(length) > header.heapBytes){
+            return false;
+        }
+        memcpy(&length, heap + offset, sizeof(length));
+        if(offset + sizeof(length) + length > header.heapBytes){
+            return false;
+        }
+        pooled.emplace(offset, pool.intern(std::string_view(heap + offset + sizeof(length), length)));
+        offset += sizeof(length) + length;
+    }
+
+    // Returns the pooled string stored at a heap offset, or nullptr if no string starts there
+    auto text = [&](std::uint64_t offset) -> const std::string* {
+        auto it = pooled.find(offset);
+        return it != pooled.end() ? it->second : nullptr;
+    };
+
+    std::vector<Record>::size_type start = recs.size();
+    recs.reserve(start + header.count);
+
+    for(std::uint32_t i = 0; i < header.count; i++){
+        Entry entry;
+        memcpy(&entry, body + i * sizeof(Entry), sizeof(entry));
+
+        const std::string *first = text(entry.first), *last = text(entry.last);
+        const std::string *id = nullptr, *date = nullptr;
+        bool valid = first != nullptr && last != nullptr;
+        if(entry.flags & TEXT_ID){
+            id = text(entry.id);
+            valid = valid && id != nullptr;
+        }else{
+            valid = valid && entry.id <= MAX_NUMERIC_ID;
+        }
+        if(entry.flags & TEXT_DATE){
+            date = text(static_cast<std::uint32_t>(entry.day));
+            valid = valid && date != nullptr;
+        }else{
+            valid = valid && entry.day >= MIN_DAY && entry.day <= MAX_DAY;
+        }
+
+        if(!valid){
+            recs.resize(start);
+            return false;
+        }
+        recs.emplace_back(entry.id, id, first, last, entry.day, date);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the size and modification time of a file, used to tell whether it has changed.
+ * @param source The path of the file.
+ * @param size Receives the size of the file.
+ * @param mtime Receives the modification time of the file, in nanoseconds.
+ * @return true if the file exists, false otherwise.
+ * */
+bool Snapshot::stamp(const std::string& source, std::uint64_t& size, std::int64_t& mtime){
+
+    struct stat info;
+    if(stat(source.c_str(), &info) != 0){
+        return false;
+    }
+    size = info.st_size;
+    mtime = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+/**
+ * @brief Continues a 64-bit FNV-1a hash over a block of bytes.
+ * @param data The bytes to hash.
+ * @param length The number of bytes.
+ * @param hash The hash of everything before data (the FNV offset basis to start a new hash).
+ * @return The hash including data.
+ * */
+std::uint64_t Snapshot::checksum(const char *data, std::size_t length, std::uint64_t hash){
+    for(std::size_t i = 0; i < length; i++){
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,53 @@
+/**
+ * The header file for the snapshot class.
+ * This stores the declarations used to write and read binary snapshots of the vax database.
+ * @brief The header file for the snapshot class.
+ * @author Justin Teichman
+ * */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <record.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class Snapshot {
+
+    public:
+        static const std::uint32_t VERSION = 1;
+
+        static bool write(const std::string& path, const std::vector<Record>& recs, const std::string& source);
+        static bool read(const std::string& path, std::vector<Record>& recs, const std::string& source);
+
+    private:
+        // Start of the file. Every field is stored in the machine's native (little-endian) byte order.
+        struct Header {
+            char magic[8];             // "VAXSNAP" followed by a zero byte
+            std::uint32_t version;     // VERSION of the layout below
+            std::uint32_t count;       // number of entries
+            std::uint64_t heapBytes;   // size of the string heap following the entries
+            std::uint64_t sourceSize;  // size of the text file the snapshot was made from
+            std::int64_t sourceMtime;  // modification time of that file, in nanoseconds
+            std::uint64_t checksum;    // FNV-1a hash of everything after the header
+        };
+
+        // One fixed-width entry per record. Strings are offsets into the heap, where each
+        // string is stored once as a 16-bit length followed by its bytes.
+        struct Entry {
+            std::uint64_t id;          // the numeric id, or the heap offset of a text id
+            std::uint32_t first;       // heap offset of the first name
+            std::uint32_t last;        // heap offset of the last name
+            std::int32_t day;          // the date as days since 1970.01.01, or the heap offset of a text date
+            std::uint32_t flags;       // TEXT_ID and TEXT_DATE
+        };
+
+        static const std::uint32_t TEXT_ID = 1;
+        static const std::uint32_t TEXT_DATE = 2;
+
+        static bool stamp(const std::string& source, std::uint64_t& size, std::int64_t& mtime);
+        static std::uint64_t checksum(const char *data, std::size_t length, std::uint64_t hash);
+};
+
+#endif
@@ -70,6 +70,12 @@ void Window::setState(std::string newState)
 	adminUIWidget->setParent(nullptr);
 	loginUIWidget->setParent(nullptr);
 
+	#ifdef USING_CAMERA
+	// The camera is only needed by the scanner; this returns within about a frame
+	if(newState != "auth")
+		camera.stop();
+	#endif
+
 	//Check for what type of state is being changed to
 	if(newState == "auth")
 	{
@@ -84,21 +90,11 @@ void Window::setState(std::string newState)
 
 		#ifdef USING_CAMERA
 
-		// Start the camera
-		while(!authUIWidget->shouldInterruptCamera())
-		{
-			// TODO: start() needs to be organized inside an object or namespace
-			start();
-
-			// TODO: need some mechanism to interrupt the camera while it's
-			// still waiting for a code inside start(), which is blocking
-
-			if(authUIWidget->isAvailable())
-			{
-				// TODO: toQRCode() needs to be organized inside an object or namespace
-				authUIWidget->authenticate(toQRCode());
-			}
-		}
+		// The camera scans on its own thread, so the GUI thread keeps running. Every code it
+		// recognizes goes into AuthUI's scan queue, with the other codes of its frame (see AuthUI::submit()).
+		camera.start([this](const std::vector<QRCode> &codes){
+			authUIWidget->submit(codes);
+		});
 
 		#endif
 	}
@@ -128,6 +124,10 @@ void Window::setState(std::string newState)
  * @brief Destroys window and the four states
  * */
 Window::~Window(){
+	#ifdef USING_CAMERA
+	camera.stop();
+	#endif
+
 	// currentState will be deleted by its parent, but the others are
 	// orphans so we need to delete them manually
 	if(currentState != "auth") delete authUIWidget;
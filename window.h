@@ -20,11 +20,7 @@
 #include "config.h"
 
 #ifdef USING_CAMERA
-
-// TODO: this should be a class or namespace, not just a set of global functions.
-// When converted, it should be includable via a header file.
-#include "Camera.cpp"
-
+#include "Camera.h"
 #endif
 
 #include "authui.h"
@@ -53,6 +49,9 @@ class Window : public QMainWindow{
 		AdminUI *adminUIWidget;
 		LoginUI *loginUIWidget;
 		std::string currentState;
+		#ifdef USING_CAMERA
+		Camera camera; // Scans on its own thread while the authentication UI is shown
+		#endif
 };
 
 #endif